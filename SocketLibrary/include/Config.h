@@ -0,0 +1,100 @@
+#ifndef __CONFIG_H
+#define __CONFIG_H
+
+#include <House.h>
+#include <Timer.h>
+#include <Fifo.h>
+
+/************************************************************
+* Runtime configuration
+*
+* Options that can't be passed through the Modelica
+* startServers call are read from the environment.
+************************************************************/
+
+#define CONFIG_PATH_LENGTH	256
+
+typedef enum transports {
+	TRANSPORT_TCP = 0,
+	TRANSPORT_SHM,
+	TRANSPORT_NUMBER
+} Transports;
+
+typedef enum io_backends {
+	IO_BACKEND_POLL = 0,
+	IO_BACKEND_URING,
+	IO_BACKEND_NUMBER
+} IoBackends;
+
+struct server_config {
+	/* HOUSE_TRANSPORT: "tcp" (default) or "shm" */
+	Transports transport;
+	/* HOUSE_SHM_PATH: shared memory segment for TRANSPORT_SHM */
+	char shm_path[CONFIG_PATH_LENGTH];
+	/* HOUSE_IO_BACKEND: "uring" (default when built with
+	 * IO_URING=1) or "poll", for TRANSPORT_TCP */
+	IoBackends io_backend;
+	/* HOUSE_IO_THREAD: "1" to run the communications on a
+	 * background thread, "0" (default) to run them on the
+	 * solver thread */
+	int io_thread;
+	/* HOUSE_MEAS_PORT, HOUSE_CMDS_PORT: listening ports for
+	 * TRANSPORT_TCP, 0 to let the system pick a free one */
+	int meas_port;
+	int cmds_port;
+	/* HOUSE_PORT_FILE: if set, file where the listening ports are
+	 * published once bound */
+	char port_file[CONFIG_PATH_LENGTH];
+	/* LISTEN_PID, LISTEN_FDS, LISTEN_FDNAMES: listening sockets
+	 * inherited from the launcher (systemd socket activation),
+	 * -1 if the socket must be created */
+	int listen_fds[SOCKET_NUMBER];
+	/* HOUSE_LAZY_ACCEPT: "1" to return from startServers right
+	 * away, the controller being accepted by the first exchange,
+	 * "0" (default) to wait for it */
+	int lazy_accept;
+	/* HOUSE_TIMERFD: "1" to wait for the step deadlines on a
+	 * timerfd, "0" (default) to use millisecond poll timeouts */
+	int timer_fd;
+	/* HOUSE_ADAPTIVE_SPEED: "1" to adjust the speed to the
+	 * controller round trip time, "0" (default) to keep it */
+	int adaptive_speed;
+	/* HOUSE_SPEED_SLACK: percentage of the first step of each
+	 * hour the adaptive speed keeps free, 50 by default */
+	int speed_slack;
+	/* HOUSE_WAIT: "block" (default), "spin" to spin before
+	 * blocking or "busy" to never block, when waiting for the
+	 * controller on the poll backend */
+	TimerWaits wait;
+	/* HOUSE_SPIN_MICROS: longest spin, and SO_BUSY_POLL time of
+	 * the "busy" wait, 50 by default */
+	int spin_micros;
+	/* HOUSE_FIFO_CAPACITY: most hours queued for the controller,
+	 * 0 (default) for no limit */
+	int fifo_capacity;
+	/* HOUSE_FIFO_POLICY: when that queue is full, "block"
+	 * (default) the solver until the controller makes room, "drop"
+	 * the oldest hour, or "coalesce" the new hour into the newest
+	 * one */
+	FifoPolicies fifo_policy;
+	/* HOUSE_SCHEMA: if set, descriptor of the measures and
+	 * commands, see Schema.h; the built-in ones otherwise */
+	char schema_path[CONFIG_PATH_LENGTH];
+	/* HOUSE_INTERVAL: simulated seconds between two exchanges
+	 * with the controller, 3600 by default */
+	int interval;
+	/* HOUSE_TIME_UNIT: simulated seconds per unit of the model
+	 * time, 60 by default: an hour is then 60 units of time */
+	int time_unit;
+};
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+void config_load(struct server_config *c);
+void config_loadSchemaPath(char *path);
+void config_setPorts(struct server_config *c, const int meas_port, const int cmds_port);
+int config_publishPorts(const struct server_config *c, const int meas_port, const int cmds_port);
+
+#endif
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 typedef struct control_buffer *ControlBuffer;
+typedef struct control_buffer_pool *CBPool;
 
 ControlBuffer CB_init(const int size);
 int CB_destroy(ControlBuffer b);
@@ -14,7 +15,21 @@ int CB_setControl(ControlBuffer b, const int32_t * const val);
 
 GBuffer CB_getBuffer(ControlBuffer b);
 
+/* A frame is the int32_t control followed by the packed values. */
+size_t CB_frameSize(ControlBuffer b);
+int CB_toFrame(ControlBuffer b, char * const frame);
+int CB_fromFrame(ControlBuffer b, const char * const frame);
+
 void CB_print(ControlBuffer b);
 
+/* Pool of buffers of the same size: released buffers are kept on
+ * a free list and handed out again, emptied, so that a warm pool
+ * makes no heap allocation. Thread-safe. */
+CBPool CB_initPool(const int size);
+void CB_destroyPool(CBPool p);
+ControlBuffer CB_get(CBPool p);
+int CB_release(ControlBuffer b);
+unsigned long CB_poolAllocated(CBPool p);
+
 #endif
 
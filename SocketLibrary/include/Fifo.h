@@ -1,14 +1,45 @@
 #ifndef __FIFO_H
 #define __FIFO_H
 
+/****************************************
+* FIFO
+*
+* Ring of item pointers, with O(1) insert
+* and pop. An unbounded FIFO grows its
+* ring when needed; a bounded one holds
+* at most [capacity] items, and inserting
+* in it when full follows its policy.
+****************************************/
+
+typedef enum fifo_policies {
+	/* fifo_insert returns FIFO_FULL, the caller waits for room */
+	FIFO_BLOCK = 0,
+	/* The oldest item is released to make room */
+	FIFO_DROP_OLDEST,
+	/* The newest item is released, the new one takes its place */
+	FIFO_COALESCE,
+	FIFO_POLICY_NUMBER
+} FifoPolicies;
+
+/* fifo_insert in a full FIFO_BLOCK FIFO. */
+#define FIFO_FULL	1
+
 typedef struct _fifo *FIFO;
 
 FIFO fifo_init(void);
+FIFO fifo_initBounded(const unsigned int capacity, const FifoPolicies policy, void (*release)(void *));
 void fifo_destroy(FIFO f);
 int fifo_insert(FIFO f, void *item);
+int fifo_requeue(FIFO f, FIFO from);
 void *fifo_peek(FIFO f);
 void *fifo_pop(FIFO f);
+unsigned int fifo_size(FIFO f);
+int fifo_isFull(FIFO f);
+unsigned int fifo_highWater(FIFO f);
+unsigned long fifo_drops(FIFO f);
+void fifo_printStats(FIFO f, const char * const name);
 void fifo_print(FIFO f, void (*printFunction)(void *));
 
 #endif
 
+
@@ -1,10 +1,53 @@
 #ifndef __BUFFER_H
 #define __BUFFER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct _GB_head *GBuffer;
 
 typedef const char * const (*PrintFunction)(const int);
 
+/************************************************************
+* Layout
+*
+* Exposed for the typed accessors below only: the values are
+* contiguous, the status of index i is bit i of the [set] and
+* [delivered] bitmaps. An index is empty (no bit), ready (set)
+* or delivered (set and delivered).
+************************************************************/
+
+/* Status bitmaps: one bit per index, 64 indexes per word. */
+#define _GB_WORD_BITS		64
+#define _GB_WORDS(size)		(((size) + _GB_WORD_BITS - 1) / _GB_WORD_BITS)
+#define _GB_WORD(i)		((i) / _GB_WORD_BITS)
+#define _GB_BIT(i)		(1ULL << ((i) % _GB_WORD_BITS))
+
+enum _GB_type {
+	_GB_DOUBLE = 0,
+	_GB_LONG_INT,
+	_GB_FLOAT,
+	_GB_TYPE_NUMBER
+};
+
+union _GB_values {
+	int32_t *int_values;
+	double *double_values;
+	float *float_values;
+	void *raw;
+};
+
+struct _GB_head {
+	enum _GB_type type;
+	int size;
+	int words;
+	/* Bits of the last bitmap word that map to an index. */
+	uint64_t last_mask;
+	union _GB_values values;
+	uint64_t *set;
+	uint64_t *delivered;
+};
+
 /************************************************************
 * Function declaration
 ************************************************************/
@@ -12,6 +55,7 @@ typedef const char * const (*PrintFunction)(const int);
 /* Initializers */
 GBuffer GB_initDouble(const int size);
 GBuffer GB_initLongInt(const int size);
+GBuffer GB_initFloat(const int size);
 int GB_destroy(GBuffer b);
 
 /* Getter */
@@ -20,6 +64,11 @@ int GB_getValue(GBuffer b, const int i, const void *res);
 /* Setter */
 int GB_setValue(GBuffer b, const int i, const void * const val);
 
+/* Bulk getter and setter */
+size_t GB_valuesSize(GBuffer b);
+int GB_getValues(GBuffer b, void *res);
+int GB_setValues(GBuffer b, const void * const val);
+
 /* Status setters */
 int GB_set(GBuffer b, const int i);
 int GB_unset(GBuffer b, const int i);
@@ -40,4 +89,53 @@ int GB_isAllDelivered(GBuffer b);
 /* Printer */
 int GB_print(GBuffer b, PrintFunction f);
 
+/************************************************************
+* Typed accessors
+*
+* GB_get<Type>/GB_set<Type> for Double, LongInt and Float
+* buffers. Debug builds call the GB_get<Type>Checked and
+* GB_set<Type>Checked variants, which validate the buffer, its
+* type, the index and, on get, that the value is set. With
+* NDEBUG they are an indexed load, or an indexed store and its
+* status bits, and always succeed.
+************************************************************/
+
+#define _GB_CHECKED_ACCESSORS(NAME, TYPE) \
+	int GB_get##NAME##Checked(GBuffer b, const int i, TYPE *res); \
+	int GB_set##NAME##Checked(GBuffer b, const int i, const TYPE val);
+
+#ifdef NDEBUG
+#define _GB_INLINE_ACCESSORS(NAME, TYPE, FIELD) \
+	static inline int GB_get##NAME(GBuffer b, const int i, TYPE *res) \
+	{ \
+		*res = b->values.FIELD[i]; \
+		return 0; \
+	} \
+	static inline int GB_set##NAME(GBuffer b, const int i, const TYPE val) \
+	{ \
+		b->values.FIELD[i] = val; \
+		b->set[_GB_WORD(i)] |= _GB_BIT(i); \
+		b->delivered[_GB_WORD(i)] &= ~_GB_BIT(i); \
+		return 0; \
+	}
+#else
+#define _GB_INLINE_ACCESSORS(NAME, TYPE, FIELD) \
+	static inline int GB_get##NAME(GBuffer b, const int i, TYPE *res) \
+	{ \
+		return GB_get##NAME##Checked(b, i, res); \
+	} \
+	static inline int GB_set##NAME(GBuffer b, const int i, const TYPE val) \
+	{ \
+		return GB_set##NAME##Checked(b, i, val); \
+	}
+#endif
+
+_GB_CHECKED_ACCESSORS(Double, double)
+_GB_CHECKED_ACCESSORS(LongInt, int32_t)
+_GB_CHECKED_ACCESSORS(Float, float)
+
+_GB_INLINE_ACCESSORS(Double, double, double_values)
+_GB_INLINE_ACCESSORS(LongInt, int32_t, int_values)
+_GB_INLINE_ACCESSORS(Float, float, float_values)
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef __GORILLA_H
+#define __GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************************************
+* MEAS stream compression
+*
+* Gorilla-style encoding of a stream of hours, each one a
+* control followed by values of a fixed set of series:
+* - a control is coded as the change of its difference with
+*   the previous control, most often 0 and coded as a single
+*   bit;
+* - a value is XORed with the previous value of its series:
+*   an unchanged value is a single bit, a changed one keeps
+*   only the bits between the leading and trailing zeros of
+*   the XOR, reusing the previous window when it fits.
+*
+* The encoder and the decoder each keep the previous control
+* and values, so that they must see the same hours in the
+* same order from the same reset. Bits are written most
+* significant first, and the last byte is padded with zeros:
+* the reader must know how many hours to read.
+************************************************************/
+
+typedef struct _gorilla *Gorilla;
+
+/* Bits of a frame, written or read one field at a time. */
+struct gorilla_stream {
+	uint8_t *data;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	int bits;
+};
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+Gorilla gorilla_init(const int series);
+void gorilla_destroy(Gorilla g);
+void gorilla_reset(Gorilla g);
+size_t gorilla_maxSize(const int values);
+
+void gorilla_open(struct gorilla_stream *b, void *data, const size_t size);
+size_t gorilla_close(struct gorilla_stream *b);
+
+int gorilla_putControl(Gorilla g, struct gorilla_stream *b, const int32_t control);
+int gorilla_putValue(Gorilla g, struct gorilla_stream *b, const int series, const double value);
+int gorilla_getControl(Gorilla g, struct gorilla_stream *b, int32_t *control);
+int gorilla_getValue(Gorilla g, struct gorilla_stream *b, const int series, double *value);
+
+#endif
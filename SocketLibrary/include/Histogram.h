@@ -0,0 +1,30 @@
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+/************************************************************
+* Latency histogram
+*
+* HDR-style log-linear buckets: values below 32 are counted
+* exactly, larger ones in 16 sub-buckets per power of two, so
+* that any percentile is reported within about 6% of the
+* recorded value. Values above HIST_MAX_VALUE are counted in
+* the last bucket; the maximum is always exact.
+************************************************************/
+
+#define HIST_MAX_VALUE	(1ULL << 40)
+
+typedef struct _histogram *Histogram;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+Histogram hist_init(void);
+void hist_destroy(Histogram h);
+int hist_record(Histogram h, const unsigned long long value);
+unsigned long long hist_count(const Histogram h);
+unsigned long long hist_max(const Histogram h);
+unsigned long long hist_percentile(const Histogram h, const double percentile);
+void hist_print(const Histogram h, const char * const name, const char * const unit);
+
+#endif
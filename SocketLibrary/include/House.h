@@ -1,6 +1,8 @@
 #ifndef __HOUSE_H
 #define __HOUSE_H
 
+#include <Schema.h>
+
 /************************************************************
 * Defines for House comms
 ************************************************************/
@@ -8,6 +10,12 @@
 #define MEAS_LISTEN_PORT	2324
 #define CMDS_LISTEN_PORT	2325
 #define CONTROL_STOP		-1
+/* MEAS control asking for all queued hours, followed by an
+ * int32_t with the maximum number of hours wanted. */
+#define CONTROL_BATCH		-2
+#define BATCH_MAX_HOURS		256
+/* MEAS control opening the handshake, see Wire.h. */
+#define CONTROL_HELLO		-3
 
 typedef enum socks {
 	SOCKET_MEAS = 0,
@@ -15,6 +23,8 @@ typedef enum socks {
 	SOCKET_NUMBER
 } Sockets;
 
+/* Measures and commands of the built-in schema, used unless a
+ * descriptor is loaded, see Schema.h. */
 typedef enum meas {
 	MEAS_ENERGY = 0,
 	MEAS_CONSUMPTION,
@@ -35,9 +45,15 @@ typedef enum commands {
 * Function declaration
 ************************************************************/
 
-Commands get_CMDS_num_from_name(const char * const name);
-Measures get_MEAS_num_from_name(const char * const name);
-const char * const get_CMDS_name_from_num(const Commands c);
-const char * const get_MEAS_name_from_num(const Measures c);
+/* The schema in use, shared by every house of the process. The
+ * first one loaded or used stays until exit. */
+int house_loadSchema(const char * const path);
+int house_hasSchema(void);
+Schema house_getSchema(void);
+
+int get_CMDS_num_from_name(const char * const name);
+int get_MEAS_num_from_name(const char * const name);
+const char * const get_CMDS_name_from_num(const int c);
+const char * const get_MEAS_name_from_num(const int c);
 
 #endif
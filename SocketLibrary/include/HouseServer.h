@@ -0,0 +1,34 @@
+#ifndef __HOUSE_SERVER_H
+#define __HOUSE_SERVER_H
+
+#include <Sockets.h>
+#include <House.h>
+
+/************************************************************
+* Multi-house server
+*
+* A single MEAS and a single CMDS listening socket are shared
+* by all houses. Every controller connection must send its
+* house ID (an int32_t in [0, houses)) as first message, and
+* is then bound to that house's socket pair. All sockets are
+* multiplexed on a single epoll instance.
+************************************************************/
+
+typedef struct _house_server *HouseServer;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+HouseServer HS_create(const unsigned short meas_port, const unsigned short cmds_port, const int houses);
+int HS_destroy(HouseServer s);
+
+struct socket_singleton *HS_getSockets(HouseServer s, const int house);
+int HS_getHouses(HouseServer s);
+int HS_getPort(HouseServer s, const Sockets type);
+
+int HS_wait(HouseServer s, struct socket_singleton *socket, const int timeout);
+int HS_disconnect(HouseServer s, const int house);
+int HS_waitHouse(HouseServer s, const int house, const int timeout);
+
+#endif
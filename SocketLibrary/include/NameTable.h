@@ -0,0 +1,24 @@
+#ifndef __NAME_TABLE_H
+#define __NAME_TABLE_H
+
+/************************************************************
+* Name table
+*
+* Maps a fixed set of names to their index, with a perfect
+* hash generated when the table is built: a lookup is one
+* hash and one string compare, whatever the number of names.
+************************************************************/
+
+typedef struct name_table *NameTable;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+NameTable names_init(const char * const * const names, const int count);
+void names_destroy(NameTable t);
+int names_find(const NameTable t, const char * const name);
+int names_count(const NameTable t);
+const char *names_get(const NameTable t, const int index);
+
+#endif
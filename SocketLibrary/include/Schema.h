@@ -0,0 +1,69 @@
+#ifndef __SCHEMA_H
+#define __SCHEMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************************************
+* House schema
+*
+* The measures sent to the controller and the commands
+* received from it, by index. A schema is either the built-in
+* one, matching the Measures and Commands enums of House.h,
+* or loaded from a descriptor file with one entry per line:
+*
+*     # comment
+*     meas <name> [every <n>] [label]
+*     cmds <name> [label]
+*
+* Indexes follow the order of the file, per kind. Names are
+* what sendOM and getOM look up, labels what the logs print.
+* A measure is due every [n] intervals, every interval by
+* default: in the intervals of control 1, 1 + n, 1 + 2n...
+* The wire frames carry, after their int32_t control, one
+* double per entry of their kind, in index order; MEAS frames
+* only carry the measures due for their control.
+************************************************************/
+
+#define SCHEMA_MAX_ENTRIES	1024
+#define SCHEMA_NAME_LENGTH	64
+/* Slowest reporting rate, in intervals. */
+#define SCHEMA_MAX_EVERY	8760
+
+typedef enum schema_kinds {
+	SCHEMA_MEAS = 0,
+	SCHEMA_CMDS,
+	SCHEMA_KIND_NUMBER
+} SchemaKinds;
+
+typedef struct house_schema *Schema;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+Schema schema_default(void);
+Schema schema_load(const char * const path);
+void schema_destroy(Schema s);
+
+int schema_count(const Schema s, const SchemaKinds kind);
+int schema_find(const Schema s, const SchemaKinds kind, const char * const name);
+const char *schema_name(const Schema s, const SchemaKinds kind, const int index);
+const char *schema_label(const Schema s, const SchemaKinds kind, const int index);
+size_t schema_frameSize(const Schema s, const SchemaKinds kind);
+int schema_every(const Schema s, const int index);
+int schema_isMultirate(const Schema s);
+int schema_dueCount(const Schema s, const int32_t control);
+
+/**
+ * Returns non-zero if the measure [index] of [s] is due in the
+ * interval of [control].
+ */
+static inline int schema_isDue(const Schema s, const int index, const int32_t control)
+{
+	int every = schema_every(s, index);
+
+	return (1 == every) || (0 == (control - 1) % every);
+}
+
+#endif
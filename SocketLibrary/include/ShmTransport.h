@@ -0,0 +1,44 @@
+#ifndef __SHM_TRANSPORT_H
+#define __SHM_TRANSPORT_H
+
+#include <stdlib.h>
+
+/************************************************************
+* Shared memory transport
+*
+* A memory-mapped segment holding, for each of the MEAS and
+* CMDS channels, a pair of single-producer/single-consumer
+* byte rings: one towards the server and one towards the
+* controller. Each channel behaves like a TCP stream, so the
+* control/ack protocol is unchanged. Waiting peers are woken
+* through futexes on the ring indexes. Sleeps are bounded, so
+* that a peer that crashed without detaching is noticed as if
+* it had closed the connection.
+************************************************************/
+
+typedef struct _shm_segment *ShmSegment;
+typedef struct _shm_channel *ShmChannel;
+
+typedef enum shm_roles {
+	SHM_ROLE_SERVER = 0,
+	SHM_ROLE_CONTROLLER,
+	SHM_ROLE_NUMBER
+} ShmRoles;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+ShmSegment SHM_create(const char * const path);
+ShmSegment SHM_attach(const char * const path);
+int SHM_detach(ShmSegment s);
+int SHM_reset(ShmSegment s);
+
+int SHM_waitPeer(ShmSegment s, const int timeout);
+ShmChannel SHM_getChannel(ShmSegment s, const int channel);
+
+int SHM_wait(ShmChannel c, const int timeout);
+int SHM_recv(ShmChannel c, char *buf, const size_t count);
+int SHM_send(ShmChannel c, const char * const buf, const size_t count);
+
+#endif
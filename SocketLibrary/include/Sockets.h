@@ -3,15 +3,42 @@
 
 #include <stdlib.h>
 #include <poll.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <ShmTransport.h>
 
 /************************************************************
 * Socket struct
 ************************************************************/
 
+/* Size of the userspace read and write buffers of a socket. */
+#define SOCKET_BUFFER_SIZE	8192
+
+struct socket_stats {
+	unsigned long long send_calls;
+	unsigned long long recv_calls;
+	unsigned long long bytes_sent;
+	unsigned long long bytes_received;
+	unsigned long long partial_sends;
+	unsigned long long partial_reads;
+};
+
 struct socket_singleton {
 	int listen_fd;
 	int accept_fd;
 	int started;
+	/* Non-NULL when the socket is carried by TRANSPORT_SHM. */
+	ShmChannel shm;
+
+	/* Userspace buffers, allocated on first use. */
+	char *write_buf;
+	size_t write_len;
+	char *read_buf;
+	size_t read_pos;
+	size_t read_len;
+
+	struct socket_stats stats;
 };
 
 /************************************************************
@@ -19,11 +46,29 @@ struct socket_singleton {
 ************************************************************/
 
 int socketBuilder(const unsigned short port, const unsigned int max_con);
+int socketPort(const int fd);
+int socketAdopt(const int fd);
 void buildPoll(struct pollfd *fds, const int fds_left, struct socket_singleton *sockets);
 int acceptConnections(const struct pollfd *fds, int fds_left, struct socket_singleton *sockets);
 
 void recv_complete(struct socket_singleton *socket, char *buf, const size_t count);
 void send_complete(struct socket_singleton *socket, const char * const buf, const size_t count);
 
+/* Buffered I/O: socket_write only gathers data, socket_flush
+ * and send_frame issue a single send for the whole frame. */
+void socket_write(struct socket_singleton *socket, const char * const buf, const size_t count);
+void socket_flush(struct socket_singleton *socket);
+void send_frame(struct socket_singleton *socket, struct iovec *iov, int iovcnt);
+size_t socket_buffered(const struct socket_singleton *socket);
+int socket_wait(const struct socket_singleton *socket, const int timeout);
+void socket_close(struct socket_singleton *socket);
+void socket_release(struct socket_singleton *socket);
+
+/* Hooks for I/O backends filling the read buffer themselves. */
+char *socket_prepareRead(struct socket_singleton *socket);
+int socket_commitRead(struct socket_singleton *socket, const ssize_t r, const size_t wanted);
+
+void socket_printStats(const struct socket_singleton *socket, const char * const name);
+
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef __SPSC_H
+#define __SPSC_H
+
+#include <stdlib.h>
+
+/************************************************************
+* Single-producer/single-consumer queue
+*
+* A bounded lock-free ring of pointers, shared by exactly one
+* producer thread and one consumer thread. Neither side ever
+* blocks: spsc_push fails when the ring is full and spsc_pop
+* returns NULL when it is empty.
+************************************************************/
+
+typedef struct _spsc *SPSC;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+SPSC spsc_init(const size_t capacity);
+void spsc_destroy(SPSC q);
+int spsc_push(SPSC q, void *item);
+void *spsc_pop(SPSC q);
+
+#endif
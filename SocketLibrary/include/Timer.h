@@ -3,15 +3,63 @@
 
 #include <stdint.h>
 
+/************************************************************
+* Communication timer
+*
+* Deadlines are kept in nanoseconds on CLOCK_MONOTONIC. Hours
+* follow an absolute schedule: each reset_timer starts the next
+* hour one interval after the previous one, so that lateness
+* is caught up instead of accumulating. An hour is never
+* started in the future, and the schedule is re-anchored on
+* the current time once it falls a whole interval behind.
+*
+* An hour is one communication interval: 3600 simulated seconds
+* unless timer_setPeriod says otherwise, which last that many
+* wall clock seconds divided by the speed.
+*
+* A speed of 0 selects lockstep mode: there is no deadline at
+* all, waits last until the controller answers.
+*
+* The speed may change at any time. In adaptive mode, it follows
+* the controller round trip times so that the commands arrive
+* within the first step of the hour, with some slack left.
+*
+* Steps shorter than the scheduler wake-up latency call for a
+* wait that spins before sleeping, or never sleeps at all.
+************************************************************/
+
 /************************************************************
 * Function declaration
 ************************************************************/
 
 typedef struct _timer * Timer;
 
+typedef enum timer_waits {
+	TIMER_WAIT_BLOCK = 0,
+	TIMER_WAIT_SPIN,
+	TIMER_WAIT_BUSY,
+	TIMER_WAIT_NUMBER
+} TimerWaits;
+
 Timer create_timer(const unsigned int speed, const unsigned int queries_per_int);
+void destroy_timer(Timer t);
+int timer_enableFd(Timer t);
+int timer_isLockstep(const Timer t);
+int timer_setWait(Timer t, const TimerWaits wait, const unsigned int spin_micros);
+void timer_printStats(const Timer t, const char * const name);
+void timer_forgetFds(Timer t);
+int timer_setSpeed(Timer t, const unsigned int speed);
+int timer_setPeriod(Timer t, const unsigned int seconds);
+unsigned int timer_getSpeed(const Timer t);
+int timer_setAdaptive(Timer t, const unsigned int slack_percent);
+void timer_adapt(Timer t, const unsigned long long rtt_micros);
 int read_possible(const Timer t, const int32_t step, const int fd_source);
 int write_possible(const Timer t, const int32_t step, const int fd_source);
 int reset_timer(Timer t);
+int timer_timeout_millis(const Timer t, const int32_t step);
+unsigned long long timer_remaining_micros(const Timer t, const int32_t step);
+unsigned long long timer_interval_micros(const Timer t);
+unsigned long long timer_now_micros(void);
+unsigned long long timer_now_nanos(void);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef __URING_H
+#define __URING_H
+
+#include <Sockets.h>
+
+/************************************************************
+* io_uring backend
+*
+* Optional replacement for the poll + recv/send sequence of
+* the local TCP session, built with "make IO_URING=1". Reads
+* are a single RECV linked to a timeout, and a MEAS frame is
+* sent with the CMDS receive that answers it chained behind,
+* so that a whole exchange costs one io_uring_enter. When the
+* backend is not built in, or the kernel refuses it,
+* uring_create returns NULL and callers keep using poll.
+************************************************************/
+
+typedef struct _uring *Uring;
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+Uring uring_create(void);
+int uring_destroy(Uring u);
+
+int uring_recv(Uring u, struct socket_singleton *socket, const int timeout);
+void uring_flush(Uring u, struct socket_singleton *out, const char * const buf, const size_t count,
+	struct socket_singleton *in, const int timeout);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __WIRE_H
+#define __WIRE_H
+
+#include <Sockets.h>
+
+#include <stdint.h>
+
+/************************************************************
+* Versioned wire framing
+*
+* A controller opens the MEAS connection by sending the
+* CONTROL_HELLO control word followed by a wire_hello. The
+* server answers with CONTROL_HELLO and a wire_hello holding
+* the agreed version and capabilities. Controllers that start
+* with a plain control word keep the legacy protocol.
+*
+* With WIRE_CAP_FRAMED, every following message on both the
+* MEAS and CMDS connections is a wire_header followed by
+* [length] bytes of payload. All fields are in host byte
+* order, like the legacy protocol.
+************************************************************/
+
+#define WIRE_VERSION		1
+#define WIRE_MAX_PAYLOAD	65536
+
+typedef enum wire_caps {
+	WIRE_CAP_FRAMED = 1 << 0,	/* length-prefixed frames */
+	WIRE_CAP_BATCH = 1 << 1,	/* multi-hour MEAS frames */
+	WIRE_CAP_SPEED = 1 << 2,	/* controller-set speed */
+	WIRE_CAP_XOR = 1 << 3		/* compressed MEAS frames */
+} WireCaps;
+
+#define WIRE_SERVER_CAPS	(WIRE_CAP_FRAMED | WIRE_CAP_BATCH | WIRE_CAP_SPEED | WIRE_CAP_XOR)
+
+typedef enum wire_types {
+	/* controller -> server, MEAS: wire_meas_request */
+	WIRE_MEAS_REQUEST = 1,
+	/* server -> controller, MEAS: int32_t hours, then for each
+	 * hour an int32_t control and a double per measure of the
+	 * schema due in that hour, see Schema.h. With WIRE_CAP_XOR,
+	 * the hours follow the count as a single Gorilla stream,
+	 * see Gorilla.h, coded since the handshake */
+	WIRE_MEAS,
+	/* controller -> server, CMDS: int32_t control, then
+	 * a double per command of the schema */
+	WIRE_CMDS,
+	/* server -> controller, CMDS: int32_t control */
+	WIRE_CMDS_ACK,
+	/* controller -> server, MEAS, in place of a request:
+	 * wire_speed, with WIRE_CAP_SPEED */
+	WIRE_SPEED,
+	WIRE_TYPE_NUMBER
+} WireTypes;
+
+struct wire_hello {
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t caps;
+};
+
+struct wire_header {
+	uint32_t length;
+	uint16_t type;
+	uint16_t flags;
+};
+
+struct wire_meas_request {
+	int32_t control;
+	/* hours wanted in the next WIRE_MEAS frame, 1 unless
+	 * WIRE_CAP_BATCH was agreed */
+	int32_t max_hours;
+};
+
+struct wire_speed {
+	/* simulated hours per wall clock hour from now on, 0 for
+	 * lockstep; stops the adaptive speed */
+	uint32_t speed;
+};
+
+#define WIRE_HEADER_SIZE	(sizeof(struct wire_header))
+
+/************************************************************
+* Function declaration
+************************************************************/
+
+int wire_accept(struct socket_singleton *socket, struct wire_hello *agreed);
+int wire_connect(struct socket_singleton *socket, const uint32_t caps, struct wire_hello *agreed);
+
+void wire_setHeader(char *frame, const WireTypes type, const uint32_t length);
+void wire_send(struct socket_singleton *socket, const WireTypes type, const void * const payload, const uint32_t length);
+int wire_recv(struct socket_singleton *socket, const WireTypes type, void *payload, const uint32_t max_length);
+int wire_recvAny(struct socket_singleton *socket, WireTypes *type, void *payload, const uint32_t max_length);
+
+#endif
@@ -7,10 +7,62 @@
 * Function declaration
 ************************************************************/
 
+/* A speed of 0 runs in lockstep: each hour waits for the
+ * controller, without any wall clock deadline. */
 void startServers(const double t, const unsigned long sec_per_step, const unsigned long sec_per_time_int);
 
+/* startServers on the given ports, 0 to let the system pick them. */
+void startServersOnPorts(const double t, const unsigned long sec_per_step, const unsigned long sec_per_time_int,
+	const int meas_port, const int cmds_port);
+
 double sendOM(const double val, const char * const name, const double t, const int32_t ctrl);
 
 double getOM(const double o, const char * const name, const double t, const int32_t ctrl);
 
+/* Handles resolve a MEAS or CMDS name once, so that sendOM_h and
+ * getOM_h skip the name lookup on every call. */
+int getMEASHandle(const char * const name);
+
+int getCMDSHandle(const char * const name);
+
+double sendOM_h(const double val, const int handle, const double t, const int32_t ctrl);
+
+double getOM_h(const double o, const int handle, const double t, const int32_t ctrl);
+
+void printCommsStats(void);
+
+/************************************************************
+* Contexts
+*
+* Each context is a server of its own, for one more simulation
+* in the same process. Calls on different contexts run in
+* parallel; calls on a context are serialized. The handles of
+* getMEASHandle and getCMDSHandle hold for every context.
+************************************************************/
+
+void *startServersContext(const double t, const unsigned long sec_per_step, const unsigned long sec_per_time_int,
+	const int meas_port, const int cmds_port);
+
+void stopServersContext(void *ctx);
+
+int getContextPort(void *ctx, const int socket);
+
+double sendOM_c(void *ctx, const double val, const int handle, const double t, const int32_t ctrl);
+
+double getOM_c(void *ctx, const double o, const int handle, const double t, const int32_t ctrl);
+
+/************************************************************
+* Multi-house server
+************************************************************/
+
+void startHouseServer(const double t, const unsigned long queries_per_int, const unsigned long speed, const int houses);
+
+double sendOMHouse(const int house, const double val, const char * const name, const double t, const int32_t ctrl);
+
+double getOMHouse(const int house, const double o, const char * const name, const double t, const int32_t ctrl);
+
+double sendOMHouse_h(const int house, const double val, const int handle, const double t, const int32_t ctrl);
+
+double getOMHouse_h(const int house, const double o, const int handle, const double t, const int32_t ctrl);
+
 #endif
@@ -0,0 +1,337 @@
+#include <Config.h>
+
+#include <Debug.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define DEFAULT_SHM_PATH	"/dev/shm/houseServer"
+
+/* Share of the first step kept free by the adaptive speed. */
+#define DEFAULT_SPEED_SLACK	50
+
+/* Longest spin of the "spin" and "busy" waits, in microseconds. */
+#define DEFAULT_SPIN_MICROS	50
+
+/* Largest MEAS queue, in hours: ten years. */
+#define MAX_FIFO_CAPACITY	87600
+
+/* Communication interval and model time unit, in seconds. */
+#define DEFAULT_INTERVAL	3600
+#define DEFAULT_TIME_UNIT	60
+#define MAX_INTERVAL		86400
+
+/* First fd passed by socket activation. */
+#define LISTEN_FDS_START	3
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static Transports get_transport_from_name(const char * const name);
+static IoBackends get_io_backend_from_name(const char * const name);
+static TimerWaits get_wait_from_name(const char * const name);
+static FifoPolicies get_fifo_policy_from_name(const char * const name);
+static int get_port(const char * const name, const int fallback);
+static int get_range(const char * const name, const int fallback, const int min, const int max);
+static void get_path(const char * const name, char *path);
+static int get_flag(const char * const name);
+static void get_listen_fds(struct server_config *c);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+/**
+ * Fills [c] with the defaults, overridden by the HOUSE_*
+ * environment variables. Throws an error on invalid values.
+ */
+void config_load(struct server_config *c)
+{
+	if (NULL == c) {
+		ERROR("config_load: NULL pointer argument.\n");
+	}
+
+	const char *env;
+
+	memset(c, 0, sizeof(*c));
+	c->transport = TRANSPORT_TCP;
+	snprintf(c->shm_path, CONFIG_PATH_LENGTH, "%s", DEFAULT_SHM_PATH);
+	c->meas_port = get_port("HOUSE_MEAS_PORT", MEAS_LISTEN_PORT);
+	c->cmds_port = get_port("HOUSE_CMDS_PORT", CMDS_LISTEN_PORT);
+	get_path("HOUSE_PORT_FILE", c->port_file);
+	get_listen_fds(c);
+	c->lazy_accept = get_flag("HOUSE_LAZY_ACCEPT");
+#ifdef HAVE_IO_URING
+	c->io_backend = IO_BACKEND_URING;
+#else
+	c->io_backend = IO_BACKEND_POLL;
+#endif
+
+	if (NULL != (env = getenv("HOUSE_TRANSPORT"))) {
+		c->transport = get_transport_from_name(env);
+		if (TRANSPORT_NUMBER <= c->transport) {
+			ERROR("config_load: unknown transport \"%s\".\n", env);
+		}
+	}
+
+	get_path("HOUSE_SHM_PATH", c->shm_path);
+	config_loadSchemaPath(c->schema_path);
+	c->interval = get_range("HOUSE_INTERVAL", DEFAULT_INTERVAL, 1, MAX_INTERVAL);
+	c->time_unit = get_range("HOUSE_TIME_UNIT", DEFAULT_TIME_UNIT, 1, MAX_INTERVAL);
+
+	if (NULL != (env = getenv("HOUSE_IO_BACKEND"))) {
+		c->io_backend = get_io_backend_from_name(env);
+		if (IO_BACKEND_NUMBER <= c->io_backend) {
+			ERROR("config_load: unknown I/O backend \"%s\".\n", env);
+		}
+	}
+
+	c->io_thread = get_flag("HOUSE_IO_THREAD");
+	c->timer_fd = get_flag("HOUSE_TIMERFD");
+	c->adaptive_speed = get_flag("HOUSE_ADAPTIVE_SPEED");
+	c->speed_slack = get_range("HOUSE_SPEED_SLACK", DEFAULT_SPEED_SLACK, 1, 99);
+
+	c->wait = TIMER_WAIT_BLOCK;
+	if (NULL != (env = getenv("HOUSE_WAIT"))) {
+		c->wait = get_wait_from_name(env);
+		if (TIMER_WAIT_NUMBER <= c->wait) {
+			ERROR("config_load: unknown wait \"%s\".\n", env);
+		}
+	}
+	c->spin_micros = get_range("HOUSE_SPIN_MICROS", DEFAULT_SPIN_MICROS, 1, 1000000);
+
+	c->fifo_capacity = get_range("HOUSE_FIFO_CAPACITY", 0, 0, MAX_FIFO_CAPACITY);
+	c->fifo_policy = FIFO_BLOCK;
+	if (NULL != (env = getenv("HOUSE_FIFO_POLICY"))) {
+		c->fifo_policy = get_fifo_policy_from_name(env);
+		if (FIFO_POLICY_NUMBER <= c->fifo_policy) {
+			ERROR("config_load: unknown FIFO policy \"%s\".\n", env);
+		}
+	}
+
+	DEBUG_PRINT("config_load: transport %d, shm path \"%s\", I/O backend %d, I/O thread %d, timerfd %d, ports %d/%d.\n",
+		c->transport, c->shm_path, c->io_backend, c->io_thread, c->timer_fd, c->meas_port, c->cmds_port);
+}
+
+/**
+ * Reads HOUSE_SCHEMA alone to [path], CONFIG_PATH_LENGTH bytes,
+ * left empty if it is not set. Unlike config_load, leaves the
+ * environment alone: the inherited sockets are still there for
+ * the server started afterwards.
+ */
+void config_loadSchemaPath(char *path)
+{
+	path[0] = '\0';
+	get_path("HOUSE_SCHEMA", path);
+}
+
+/**
+ * Overrides the listening ports of [c]. Throws an error on invalid
+ * ports.
+ */
+void config_setPorts(struct server_config *c, const int meas_port, const int cmds_port)
+{
+	if ((0 > meas_port) || (65535 < meas_port) || (0 > cmds_port) || (65535 < cmds_port)) {
+		ERROR("config_setPorts: invalid ports %d/%d.\n", meas_port, cmds_port);
+	}
+	c->meas_port = meas_port;
+	c->cmds_port = cmds_port;
+}
+
+/**
+ * Writes the ports actually bound to the port file of [c], if any.
+ * The file is written aside and renamed, so that a launcher polling
+ * for it never reads it half-written.
+ * Returns 0 on success, non-zero on failure.
+ */
+int config_publishPorts(const struct server_config *c, const int meas_port, const int cmds_port)
+{
+	char tmp[CONFIG_PATH_LENGTH + 8];
+	FILE *f;
+
+	if ('\0' == c->port_file[0]) {
+		return 0;
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", c->port_file);
+	if (NULL == (f = fopen(tmp, "w"))) {
+		WARNING("config_publishPorts: unable to create \"%s\".\n", tmp);
+		return 1;
+	}
+	fprintf(f, "pid=%ld\nmeas_port=%d\ncmds_port=%d\n", (long) getpid(), meas_port, cmds_port);
+	if (fclose(f) || rename(tmp, c->port_file)) {
+		WARNING("config_publishPorts: unable to publish \"%s\".\n", c->port_file);
+		unlink(tmp);
+		return 1;
+	}
+
+	DEBUG_PRINT("config_publishPorts: ports %d/%d published to \"%s\".\n", meas_port, cmds_port, c->port_file);
+
+	return 0;
+}
+
+static Transports get_transport_from_name(const char * const name)
+{
+	if (0 == strcmp(name, "tcp")) {
+		return TRANSPORT_TCP;
+	}
+	else if (0 == strcmp(name, "shm")) {
+		return TRANSPORT_SHM;
+	}
+	else {
+		return TRANSPORT_NUMBER;
+	}
+}
+
+static IoBackends get_io_backend_from_name(const char * const name)
+{
+	if (0 == strcmp(name, "poll")) {
+		return IO_BACKEND_POLL;
+	}
+	else if (0 == strcmp(name, "uring")) {
+		return IO_BACKEND_URING;
+	}
+	else {
+		return IO_BACKEND_NUMBER;
+	}
+}
+
+static TimerWaits get_wait_from_name(const char * const name)
+{
+	if (0 == strcmp(name, "block")) {
+		return TIMER_WAIT_BLOCK;
+	}
+	else if (0 == strcmp(name, "spin")) {
+		return TIMER_WAIT_SPIN;
+	}
+	else if (0 == strcmp(name, "busy")) {
+		return TIMER_WAIT_BUSY;
+	}
+	else {
+		return TIMER_WAIT_NUMBER;
+	}
+}
+
+static FifoPolicies get_fifo_policy_from_name(const char * const name)
+{
+	if (0 == strcmp(name, "block")) {
+		return FIFO_BLOCK;
+	}
+	else if (0 == strcmp(name, "drop")) {
+		return FIFO_DROP_OLDEST;
+	}
+	else if (0 == strcmp(name, "coalesce")) {
+		return FIFO_COALESCE;
+	}
+	else {
+		return FIFO_POLICY_NUMBER;
+	}
+}
+
+static int get_port(const char * const name, const int fallback)
+{
+	return get_range(name, fallback, 0, 65535);
+}
+
+static int get_range(const char * const name, const int fallback, const int min, const int max)
+{
+	const char *env = getenv(name);
+	char *end;
+	long value;
+
+	if (NULL == env) {
+		return fallback;
+	}
+	value = strtol(env, &end, 10);
+	if (('\0' == env[0]) || ('\0' != *end) || (min > value) || (max < value)) {
+		ERROR("config_load: invalid value %s=\"%s\", must be in [%d, %d].\n", name, env, min, max);
+	}
+	return (int) value;
+}
+
+static void get_path(const char * const name, char *path)
+{
+	const char *env = getenv(name);
+
+	if (NULL == env) {
+		return;
+	}
+	if (CONFIG_PATH_LENGTH <= strlen(env)) {
+		ERROR("config_load: %s is too long.\n", name);
+	}
+	snprintf(path, CONFIG_PATH_LENGTH, "%s", env);
+}
+
+static int get_flag(const char * const name)
+{
+	const char *env = getenv(name);
+
+	if (NULL == env) {
+		return 0;
+	}
+	if ((0 != strcmp(env, "0")) && (0 != strcmp(env, "1"))) {
+		ERROR("config_load: %s must be \"0\" or \"1\".\n", name);
+	}
+	return '1' == env[0];
+}
+
+/**
+ * Picks the MEAS and CMDS listening sockets passed by the launcher,
+ * systemd style: LISTEN_FDS sockets from fd 3 on, for process
+ * LISTEN_PID. They are told apart by LISTEN_FDNAMES ("meas" and
+ * "cmds"), or are MEAS then CMDS. The variables are then cleared,
+ * so that they don't leak to child processes.
+ */
+static void get_listen_fds(struct server_config *c)
+{
+	const char *pid = getenv("LISTEN_PID");
+	const char *fds = getenv("LISTEN_FDS");
+	const char *names = getenv("LISTEN_FDNAMES");
+	char buf[CONFIG_PATH_LENGTH], *name, *save = NULL;
+	int n, i;
+
+	c->listen_fds[SOCKET_MEAS] = -1;
+	c->listen_fds[SOCKET_CMDS] = -1;
+
+	if (NULL == fds) {
+		return;
+	}
+	if ((NULL != pid) && (atol(pid) != (long) getpid())) {
+		DEBUG_PRINT("config_load: LISTEN_FDS is meant for process %s.\n", pid);
+		return;
+	}
+
+	n = atoi(fds);
+	if (NULL == names) {
+		if (SOCKET_NUMBER <= n) {
+			c->listen_fds[SOCKET_MEAS] = LISTEN_FDS_START;
+			c->listen_fds[SOCKET_CMDS] = LISTEN_FDS_START + 1;
+		}
+	}
+	else {
+		snprintf(buf, sizeof(buf), "%s", names);
+		for (i = 0, name = strtok_r(buf, ":", &save); (i < n) && (NULL != name); ++i, name = strtok_r(NULL, ":", &save)) {
+			if (0 == strcmp(name, "meas")) {
+				c->listen_fds[SOCKET_MEAS] = LISTEN_FDS_START + i;
+			}
+			else if (0 == strcmp(name, "cmds")) {
+				c->listen_fds[SOCKET_CMDS] = LISTEN_FDS_START + i;
+			}
+		}
+	}
+	if ((0 > c->listen_fds[SOCKET_MEAS]) || (0 > c->listen_fds[SOCKET_CMDS])) {
+		ERROR("config_load: LISTEN_FDS=%s does not carry both the MEAS and CMDS sockets.\n", fds);
+	}
+
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_FDNAMES");
+}
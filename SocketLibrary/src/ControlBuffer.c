@@ -4,6 +4,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 enum _CB_return_values {
 	_CB_SUCCESS = 0,
@@ -14,6 +16,18 @@ enum _CB_return_values {
 struct control_buffer {
 	int32_t control;
 	GBuffer buffer;
+	/* Pool the buffer returns to, NULL if not pooled. */
+	CBPool pool;
+	/* Next free buffer of the pool. */
+	struct control_buffer *next;
+};
+
+struct control_buffer_pool {
+	int size;
+	pthread_mutex_t lock;
+	struct control_buffer *free;
+	/* Buffers ever allocated by the pool. */
+	unsigned long allocated;
 };
 
 static int CB_check(ControlBuffer b, const char * const fname);
@@ -97,6 +111,55 @@ GBuffer CB_getBuffer(ControlBuffer b)
 	return b->buffer;
 }
 
+/**
+ * Returns the size in bytes of the frame of [b], 0 if [b] is not
+ * valid.
+ */
+size_t CB_frameSize(ControlBuffer b)
+{
+	if (_CB_SUCCESS != CB_check(b, "CB_frameSize")) {
+		return 0;
+	}
+
+	return sizeof(int32_t) + GB_valuesSize(b->buffer);
+}
+
+/**
+ * Writes the control and all the values of [b] to [frame],
+ * CB_frameSize bytes. Fails unless the buffer is full.
+ */
+int CB_toFrame(ControlBuffer b, char * const frame)
+{
+	if (_CB_SUCCESS != CB_check(b, "CB_toFrame")) {
+		return -_CB_FAILED;
+	}
+
+	if (0 != GB_getValues(b->buffer, frame + sizeof(int32_t))) {
+		return -_CB_FAILED;
+	}
+	memcpy(frame, &b->control, sizeof(int32_t));
+
+	return _CB_SUCCESS;
+}
+
+/**
+ * Reads the control and all the values of [b] from [frame],
+ * CB_frameSize bytes. The buffer is then full.
+ */
+int CB_fromFrame(ControlBuffer b, const char * const frame)
+{
+	if (_CB_SUCCESS != CB_check(b, "CB_fromFrame")) {
+		return -_CB_FAILED;
+	}
+
+	memcpy(&b->control, frame, sizeof(int32_t));
+	if (0 != GB_setValues(b->buffer, frame + sizeof(int32_t))) {
+		return -_CB_FAILED;
+	}
+
+	return _CB_SUCCESS;
+}
+
 static int CB_check(ControlBuffer b, const char * const fname)
 {
 	if (NULL == b) {
@@ -110,6 +173,114 @@ static int CB_check(ControlBuffer b, const char * const fname)
 	return _CB_SUCCESS;
 }
 
+/**
+ * Creates an empty pool of buffers of [size] values.
+ */
+CBPool CB_initPool(const int size)
+{
+	if (0 >= size) {
+		DEBUG_PRINT("CB_initPool: illegal size %d.\n", size);
+		return NULL;
+	}
+
+	struct control_buffer_pool *ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("CB_initPool: calloc failed.\n");
+		return NULL;
+	}
+	if (pthread_mutex_init(&ret->lock, NULL)) {
+		DEBUG_PRINT("CB_initPool: mutex init failed.\n");
+		free(ret);
+		return NULL;
+	}
+	ret->size = size;
+
+	return ret;
+}
+
+/**
+ * Frees [p] and its free buffers. All the buffers taken from it
+ * must have been released.
+ */
+void CB_destroyPool(CBPool p)
+{
+	ControlBuffer b;
+
+	if (NULL == p) {
+		return;
+	}
+	while (NULL != (b = p->free)) {
+		p->free = b->next;
+		CB_destroy(b);
+	}
+	pthread_mutex_destroy(&p->lock);
+	free(p);
+}
+
+/**
+ * Returns an empty buffer, with control 0, from the free list of
+ * [p], or a new one if there is none. NULL on failure.
+ */
+ControlBuffer CB_get(CBPool p)
+{
+	ControlBuffer ret;
+
+	if (NULL == p) {
+		DEBUG_PRINT("CB_get: NULL pointer argument.\n");
+		return NULL;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	if (NULL != (ret = p->free)) {
+		p->free = ret->next;
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	if (NULL == ret) {
+		if (NULL == (ret = CB_init(p->size))) {
+			return NULL;
+		}
+		ret->pool = p;
+		__atomic_add_fetch(&p->allocated, 1, __ATOMIC_RELAXED);
+		return ret;
+	}
+
+	ret->control = 0;
+	ret->next = NULL;
+	GB_empty(ret->buffer);
+	return ret;
+}
+
+/**
+ * Gives [b] back to the pool it was taken from, or frees it if
+ * it was not taken from a pool.
+ */
+int CB_release(ControlBuffer b)
+{
+	if (_CB_SUCCESS != CB_check(b, "CB_release")) {
+		return -_CB_FAILED;
+	}
+
+	if (NULL == b->pool) {
+		return CB_destroy(b);
+	}
+
+	pthread_mutex_lock(&b->pool->lock);
+	b->next = b->pool->free;
+	b->pool->free = b;
+	pthread_mutex_unlock(&b->pool->lock);
+
+	return _CB_SUCCESS;
+}
+
+/**
+ * Returns the number of buffers [p] ever allocated.
+ */
+unsigned long CB_poolAllocated(CBPool p)
+{
+	return (NULL == p) ? 0 : __atomic_load_n(&p->allocated, __ATOMIC_RELAXED);
+}
+
 void CB_print(ControlBuffer b)
 {
 	if (_CB_SUCCESS != CB_check(b, "CB_print")) {
@@ -1,4 +1,3 @@
-
 #include <Fifo.h>
 
 #include <Debug.h>
@@ -14,11 +13,16 @@
 #define _FIFO_INVALID	-1
 #define _FIFO_FAILED	-2
 
+/* Ring slots of an unbounded FIFO, at first. */
+#define _FIFO_INITIAL_SLOTS	16
+
 /****************************************
 * Local functions declaration
 ****************************************/
 
 static int _fifo_check(FIFO f, const char * const fname);
+static int _fifo_grow(FIFO f, const unsigned int slots);
+static void *_fifo_item(FIFO f, const unsigned int i);
 
 /****************************************
 * Local structs definition
@@ -26,13 +30,19 @@ static int _fifo_check(FIFO f, const char * const fname);
 
 /* This holds the whole FIFO */
 struct _fifo {
-	struct _fifoNode *first;
-};
-
-/* This holds a single item in the FIFO */
-struct _fifoNode {
-	struct _fifoNode *next;
-	void *item;
+	/* Ring of [slots] items, [count] of them starting at [first]. */
+	void **items;
+	unsigned int slots;
+	unsigned int first;
+	unsigned int count;
+	/* Most items held, 0 if unbounded. */
+	unsigned int capacity;
+	FifoPolicies policy;
+	/* Frees the items dropped or coalesced. */
+	void (*release)(void *);
+	/* Most items held at once, and items dropped or coalesced. */
+	unsigned int high_water;
+	unsigned long drops;
 };
 
 /****************************************
@@ -40,18 +50,48 @@ struct _fifoNode {
 ****************************************/
 
 /**
- * Creates an empty FIFO.
+ * Creates an empty, unbounded FIFO.
  * Returns NULL on failure.
  */
 FIFO fifo_init(void)
 {
+	return fifo_initBounded(0, FIFO_BLOCK, NULL);
+}
+
+/**
+ * Creates an empty FIFO of at most [capacity] items, 0 for an
+ * unbounded one. When full, inserting follows [policy]; [release]
+ * frees the items the FIFO_DROP_OLDEST and FIFO_COALESCE policies
+ * discard.
+ * Returns NULL on failure.
+ */
+FIFO fifo_initBounded(const unsigned int capacity, const FifoPolicies policy, void (*release)(void *))
+{
+	if(FIFO_POLICY_NUMBER <= policy) {
+		DEBUG_PRINT("fifo_init: policy %d is not valid.\n", policy);
+		return NULL;
+	}
+	if((FIFO_BLOCK != policy) && (NULL == release)) {
+		DEBUG_PRINT("fifo_init: discarding policy without release function.\n");
+		return NULL;
+	}
+
 	struct _fifo *ret = (struct _fifo *) calloc(1, sizeof *ret);
 	if(NULL == ret) {
 		DEBUG_PRINT("fifo_init: calloc failed.\n");
 		return NULL;
 	}
 
-	ret->first = NULL;
+	ret->slots = (0 < capacity) ? capacity : _FIFO_INITIAL_SLOTS;
+	ret->items = (void **) calloc(ret->slots, sizeof(void *));
+	if(NULL == ret->items) {
+		DEBUG_PRINT("fifo_init: calloc failed.\n");
+		free(ret);
+		return NULL;
+	}
+	ret->capacity = capacity;
+	ret->policy = policy;
+	ret->release = release;
 
 	return ret;
 }
@@ -66,16 +106,18 @@ void fifo_destroy(FIFO f)
 		return;
 	}
 
-	if(NULL != f->first) {
+	if(0 != f->count) {
 		DEBUG_PRINT("fifo_destroy: deleting non empty fifo.\n");
 	}
 
+	free(f->items);
 	free(f);
 }
 
 /**
  * Inserts an element in the FIFO.
- * Returns 0 on success, non zero on failure.
+ * Returns 0 on success, FIFO_FULL if a full FIFO_BLOCK FIFO had
+ * no room for it, another non zero value on failure.
  */
 int fifo_insert(FIFO f, void *item)
 {
@@ -83,25 +125,63 @@ int fifo_insert(FIFO f, void *item)
 		return _FIFO_FAILED;
 	}
 
-	struct _fifoNode *new = (struct _fifoNode *) calloc(1, sizeof *new);
-	if(NULL == new) {
-		DEBUG_PRINT("fifo_insert: calloc failed.\n");
+	if(fifo_isFull(f)) {
+		switch(f->policy) {
+		case FIFO_BLOCK:
+			return FIFO_FULL;
+		case FIFO_DROP_OLDEST:
+			f->release(fifo_pop(f));
+			++f->drops;
+			break;
+		case FIFO_COALESCE:
+			f->release(_fifo_item(f, f->count - 1));
+			f->items[(f->first + f->count - 1) % f->slots] = item;
+			++f->drops;
+			return _FIFO_SUCCESS;
+		default:
+			DEBUG_PRINT("fifo_insert: policy not recognized, this should not have happened.\n");
+			return _FIFO_INVALID;
+		}
+	}
+
+	if((f->slots == f->count) && _fifo_grow(f, 2 * f->slots)) {
 		return _FIFO_FAILED;
 	}
 
-	new->item = item;
-	new->next = NULL;
+	f->items[(f->first + f->count) % f->slots] = item;
+	++f->count;
+	if(f->count > f->high_water) {
+		f->high_water = f->count;
+	}
 
-	if(NULL == f->first) {
-		f->first = new;
-		return _FIFO_SUCCESS;
+	return _FIFO_SUCCESS;
+}
+
+/**
+ * Moves all the elements of [from] in front of the ones of [f],
+ * in the same order, even past the capacity of [f].
+ * Returns 0 on success, non zero on failure.
+ */
+int fifo_requeue(FIFO f, FIFO from)
+{
+	if((_FIFO_SUCCESS != _fifo_check(f, "fifo_requeue")) || (_FIFO_SUCCESS != _fifo_check(from, "fifo_requeue"))) {
+		return _FIFO_FAILED;
+	}
+
+	if((f->slots < f->count + from->count) && _fifo_grow(f, f->count + from->count)) {
+		return _FIFO_FAILED;
 	}
 
-	struct _fifoNode *last = f->first;
-	while(NULL != last->next) {
-		last = last->next;
+	while(0 < from->count) {
+		f->first = (f->first + f->slots - 1) % f->slots;
+		f->items[f->first] = _fifo_item(from, from->count - 1);
+		++f->count;
+		--from->count;
+	}
+	from->first = 0;
+	if(f->count > f->high_water) {
+		f->high_water = f->count;
 	}
-	last->next = new;
 
 	return _FIFO_SUCCESS;
 }
@@ -117,11 +197,11 @@ void *fifo_peek(FIFO f)
 		return NULL;
 	}
 
-	if(NULL == f->first) {
+	if(0 == f->count) {
 		return NULL;
 	}
 	else {
-		return f->first->item;
+		return f->items[f->first];
 	}
 }
 
@@ -136,14 +216,80 @@ void *fifo_pop(FIFO f)
 		return NULL;
 	}
 
-	struct _fifoNode *top = f->first;
-	if(NULL != top) {
-		f->first = top->next;
-		void *res = top->item;
-		free(top);
-		return res;
+	if(0 == f->count) {
+		return NULL;
+	}
+
+	void *res = f->items[f->first];
+	f->first = (f->first + 1) % f->slots;
+	--f->count;
+	return res;
+}
+
+/**
+ * Returns the number of elements in the FIFO.
+ */
+unsigned int fifo_size(FIFO f)
+{
+	if(_FIFO_SUCCESS != _fifo_check(f, "fifo_size")) {
+		return 0;
+	}
+	return f->count;
+}
+
+/**
+ * Returns non zero if a bounded FIFO holds as many elements as
+ * it can.
+ */
+int fifo_isFull(FIFO f)
+{
+	if(_FIFO_SUCCESS != _fifo_check(f, "fifo_isFull")) {
+		return 0;
+	}
+	return (0 < f->capacity) && (f->count >= f->capacity);
+}
+
+/**
+ * Returns the most elements the FIFO held at once.
+ */
+unsigned int fifo_highWater(FIFO f)
+{
+	if(_FIFO_SUCCESS != _fifo_check(f, "fifo_highWater")) {
+		return 0;
+	}
+	return f->high_water;
+}
+
+/**
+ * Returns the number of elements dropped or coalesced because the
+ * FIFO was full.
+ */
+unsigned long fifo_drops(FIFO f)
+{
+	if(_FIFO_SUCCESS != _fifo_check(f, "fifo_drops")) {
+		return 0;
+	}
+	return f->drops;
+}
+
+/**
+ * Prints the occupancy of the FIFO, on a single line.
+ */
+void fifo_printStats(FIFO f, const char * const name)
+{
+	static const char * const policies[FIFO_POLICY_NUMBER] = { "block", "drop", "coalesce" };
+
+	if(_FIFO_SUCCESS != _fifo_check(f, "fifo_printStats")) {
+		return;
+	}
+
+	if(0 == f->capacity) {
+		WARNING("%s: %u queued, high water %u, unbounded.\n", name, f->count, f->high_water);
+	}
+	else {
+		WARNING("%s: %u queued, high water %u of %u, %s when full, %lu dropped.\n",
+			name, f->count, f->high_water, f->capacity, policies[f->policy], f->drops);
 	}
-	return NULL;
 }
 
 /**
@@ -157,13 +303,10 @@ void fifo_print(FIFO f, void (*printFunction)(void *))
 	}
 
 	DEBUG_PRINT("Printing FIFO.\n");
-	struct _fifoNode *current = f->first;
-	int i = 0;
-	while(NULL != current) {
-		++i;
-		DEBUG_PRINT("Printing item %d at position %p:\n", i, current->item);
-		printFunction(current->item);
-		current = current->next;
+	unsigned int i;
+	for(i = 0; i < f->count; ++i) {
+		DEBUG_PRINT("Printing item %u at position %p:\n", i + 1, _fifo_item(f, i));
+		printFunction(_fifo_item(f, i));
 	}
 	if(0 == i) {
 		DEBUG_PRINT("FIFO is empty.\n");
@@ -180,13 +323,45 @@ void fifo_print(FIFO f, void (*printFunction)(void *))
  */
 static int _fifo_check(FIFO f, const char * const fname)
 {
-	if(NULL == f) {
+	if((NULL == f) || (NULL == f->items)) {
 		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
 		return _FIFO_INVALID;
 	}
 	return _FIFO_SUCCESS;
 }
 
+/**
+ * Moves the elements of the FIFO to a new ring of [slots], in
+ * order from its start.
+ */
+static int _fifo_grow(FIFO f, const unsigned int slots)
+{
+	void **items = (void **) calloc(slots, sizeof(void *));
+	unsigned int i;
+
+	if(NULL == items) {
+		DEBUG_PRINT("fifo_insert: calloc failed.\n");
+		return _FIFO_FAILED;
+	}
+	for(i = 0; i < f->count; ++i) {
+		items[i] = _fifo_item(f, i);
+	}
+	free(f->items);
+	f->items = items;
+	f->slots = slots;
+	f->first = 0;
+
+	return _FIFO_SUCCESS;
+}
+
+/**
+ * Returns the [i]-th element from the start of the FIFO.
+ */
+static void *_fifo_item(FIFO f, const unsigned int i)
+{
+	return f->items[(f->first + i) % f->slots];
+}
+
 
 
 
@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
 /************************************************************
@@ -14,45 +15,15 @@
 #define _GB_FAILED		-1
 #define _GB_INVALID		-2
 
-enum _GB_status {
-	_GB_STATUS_EMPTY = 0,
-	_GB_STATUS_READY,
-	_GB_STATUS_DELIVERED,
-	_GB_STATUS_NUMBER
-};
-
-enum _GB_type {
-	_GB_DOUBLE = 0,
-	_GB_LONG_INT,
-	_GB_TYPE_NUMBER
-};
-
-/************************************************************
-* Types, structs, and unions
-************************************************************/
-
-union _GB_value {
-	int32_t int_value;
-	double double_value;
-};
-
-struct _GB_node {
-	enum _GB_status status;
-	union _GB_value value;
-};
-
-struct _GB_head {
-	enum _GB_type type;
-	int size;
-	struct _GB_node *head;
-};
-
 /************************************************************
 * Local functions declaration
 ************************************************************/
 
 static GBuffer GB_init(const int size, const enum _GB_type type);
 static int GB_check(GBuffer b, const char * const fname);
+static int GB_checkIndex(GBuffer b, const int i, const char * const fname);
+static int GB_allSet(GBuffer b, const uint64_t * const bits);
+static size_t GB_valueSize(const enum _GB_type type);
 
 /************************************************************
 * Initialization functions
@@ -74,6 +45,14 @@ GBuffer GB_initLongInt(const int size)
 	return GB_init(size, _GB_LONG_INT);
 }
 
+/**
+ * Returns a pointer to a new GeneralBuffer<Float>
+ */
+GBuffer GB_initFloat(const int size)
+{
+	return GB_init(size, _GB_FLOAT);
+}
+
 /**
  * Returns a pointer to a new (and empty) GeneralBuffer<type>
  */
@@ -95,17 +74,22 @@ static GBuffer GB_init(const int size, const enum _GB_type type)
 		return NULL;
 	}
 
-	ret->head = (struct _GB_node *) calloc(size, sizeof (struct _GB_head));
-	if(NULL == ret->head) {
+	ret->type = type;
+	ret->size = size;
+	ret->words = _GB_WORDS(size);
+	ret->last_mask = (0 == size % _GB_WORD_BITS) ? ~0ULL : (_GB_BIT(size) - 1);
+
+	ret->values.raw = calloc(size, GB_valueSize(type));
+	/* Both bitmaps in a single block. */
+	ret->set = (uint64_t *) calloc(2 * ret->words, sizeof (uint64_t));
+	if((NULL == ret->values.raw) || (NULL == ret->set)) {
+		free(ret->values.raw);
+		free(ret->set);
 		free(ret);
 		DEBUG_PRINT("GB_init: calloc failed.\n");
 		return NULL;
 	}
-
-	ret->type = type;
-	ret->size = size;
-
-	GB_empty(ret);
+	ret->delivered = ret->set + ret->words;
 
 	return ret;
 }
@@ -116,7 +100,8 @@ int GB_destroy(GBuffer b)
 		return _GB_INVALID;
 	}
 
-	free(b->head);
+	free(b->values.raw);
+	free(b->set);
 
 	free(b);
 
@@ -124,13 +109,59 @@ int GB_destroy(GBuffer b)
 }
 
 /************************************************************
-* Getters
+* Typed getters and setters
 ************************************************************/
 
+/*
+ * Defines GB_get<NAME>Checked and GB_set<NAME>Checked for the
+ * buffers of type [TAG]. [FORMAT] prints a [TYPE] value.
+ */
+#define _GB_CHECKED_DEFINITIONS(NAME, TYPE, TAG, FIELD, FORMAT) \
+int GB_get##NAME##Checked(GBuffer b, const int i, TYPE *res) \
+{ \
+	int rv; \
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_get" #NAME))) { \
+		return rv; \
+	} \
+	if(TAG != b->type) { \
+		DEBUG_PRINT("GB_get" #NAME ": type mismatch.\n"); \
+		return _GB_INVALID; \
+	} \
+	if(!(b->set[_GB_WORD(i)] & _GB_BIT(i))) { \
+		DEBUG_PRINT("GB_get" #NAME ": buffer[%d] is not set.\n", i); \
+		return _GB_FAILED; \
+	} \
+	*res = b->values.FIELD[i]; \
+	return _GB_SUCCESS; \
+} \
+\
+int GB_set##NAME##Checked(GBuffer b, const int i, const TYPE val) \
+{ \
+	int rv; \
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_set" #NAME))) { \
+		return rv; \
+	} \
+	if(TAG != b->type) { \
+		DEBUG_PRINT("GB_set" #NAME ": type mismatch.\n"); \
+		return _GB_INVALID; \
+	} \
+	if(b->set[_GB_WORD(i)] & _GB_BIT(i)) { \
+		DEBUG_PRINT("GB_set" #NAME ": buffer[%d] was already set to " FORMAT ".\n", i, b->values.FIELD[i]); \
+	} \
+	b->values.FIELD[i] = val; \
+	b->set[_GB_WORD(i)] |= _GB_BIT(i); \
+	b->delivered[_GB_WORD(i)] &= ~_GB_BIT(i); \
+	return _GB_SUCCESS; \
+}
+
+_GB_CHECKED_DEFINITIONS(Double, double, _GB_DOUBLE, double_values, "%e")
+_GB_CHECKED_DEFINITIONS(LongInt, int32_t, _GB_LONG_INT, int_values, "%d")
+_GB_CHECKED_DEFINITIONS(Float, float, _GB_FLOAT, float_values, "%e")
+
 /**
- * Gets the double value at index [i]. Throws an error if
- * the value is not set, the buffer is not a double buffer,
- * or the index is out of range.
+ * Gets the value at index [i], whatever the type of the buffer.
+ * Throws an error if the value is not set or the index is out of
+ * range.
  */
 int GB_getValue(GBuffer b, const int i, const void *ret)
 {
@@ -138,65 +169,23 @@ int GB_getValue(GBuffer b, const int i, const void *ret)
 		return _GB_INVALID;
 	}
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_getValue: index %d out of buffer range %d.\n", i, b->size);
-		return _GB_FAILED;
-	}
-
-	if(_GB_STATUS_EMPTY == b->head[i].status) {
-		DEBUG_PRINT("GB_getValue: buffer[%d] is not set.\n", i);
-		return _GB_FAILED;
-	}
-
 	switch(b->type) {
 		case _GB_DOUBLE:
-			*((double *) ret) = b->head[i].value.double_value;
-			break;
+			return GB_getDoubleChecked(b, i, (double *) ret);
 		case _GB_LONG_INT:
-			*((int32_t *) ret) = b->head[i].value.int_value;
-			break;
+			return GB_getLongIntChecked(b, i, (int32_t *) ret);
+		case _GB_FLOAT:
+			return GB_getFloatChecked(b, i, (float *) ret);
 		default:
 			DEBUG_PRINT("GB_getValue: buffer type not recognized, this should not have happened.\n");
 			return _GB_INVALID;
 	}
-
-	return _GB_SUCCESS;
 }
 
-///**
-// * Gets the int32_t value at index [i]. Throws an error if
-// * the value is not set, the buffer is not a int32_t buffer,
-// * or the index is out of range.
-// */
-//int32_t GB_getLongIntValue(GBuffer b, const int i)
-//{
-//	if(NULL == b) {
-//		DEBUG_PRINT("GB_getLongIntValue: NULL pointer argument.\n");
-//	}
-//
-//	if(_GB_LONG_INT != b->type) {
-//		DEBUG_PRINT("GB_getLongIntValue: type mismatch.\n");
-//	}
-//
-//	if(i >= b->size) {
-//		DEBUG_PRINT("GB_getLongIntValue: index %d out of buffer range %d.\n", i, b->size);
-//	}
-//
-//	if(_GB_STATUS_EMPTY == b->head[i].status) {
-//		DEBUG_PRINT("GB_getLongIntValue: buffer[%d] is not set.\n", i);
-//	}
-//
-//	return b->head[i].value.int_value;
-//}
-
-/************************************************************
-* Setters
-************************************************************/
-
 /**
- * Sets the double value at index [i] to [v]. Throws an error if
- * the buffer is not a double buffer or the index is out of range.
- * Gives a warning if the index was not empty.
+ * Sets the value at index [i] to [val], whatever the type of the
+ * buffer. Throws an error if the index is out of range. Gives a
+ * warning if the index was not empty.
  */
 int GB_setValue(GBuffer b, const int i, const void * const  val)
 {
@@ -204,59 +193,78 @@ int GB_setValue(GBuffer b, const int i, const void * const  val)
 		return _GB_INVALID;
 	}
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_setValue: index %d out of buffer range %d.\n", i, b->size);
-		return _GB_FAILED;
-	}
-
 	switch(b->type) {
 		case _GB_DOUBLE:
-			if(_GB_STATUS_EMPTY != b->head[i].status) {
-				DEBUG_PRINT("GB_setValue: buffer[%d] was already set to %e.\n", i, b->head[i].value.double_value);
-			}
-			b->head[i].value.double_value = *(double *) val;
-			break;
+			return GB_setDoubleChecked(b, i, *(const double *) val);
 		case _GB_LONG_INT:
-			if(_GB_STATUS_EMPTY != b->head[i].status) {
-				DEBUG_PRINT("GB_setValue: buffer[%d] was already set to %d.\n", i, b->head[i].value.int_value);
-			}
-			b->head[i].value.int_value = *(int32_t *) val;
-			break;
+			return GB_setLongIntChecked(b, i, *(const int32_t *) val);
+		case _GB_FLOAT:
+			return GB_setFloatChecked(b, i, *(const float *) val);
 		default:
 			DEBUG_PRINT("GB_setValue: buffer type not recognized, this should not have happened.\n");
 			return _GB_INVALID;
 	}
+}
+
+/************************************************************
+* Bulk getters and setters
+************************************************************/
 
-	b->head[i].status = _GB_STATUS_READY;
+/**
+ * Returns the size in bytes of all the values of [b], 0 if [b] is
+ * not valid.
+ */
+size_t GB_valuesSize(GBuffer b)
+{
+	if(_GB_SUCCESS != GB_check(b, "GB_valuesSize")) {
+		return 0;
+	}
+
+	return b->size * GB_valueSize(b->type);
+}
+
+/**
+ * Copies all the values of [b] to [res], packed in index order
+ * (GB_valuesSize bytes, no alignment required). Fails unless the
+ * buffer is full.
+ */
+int GB_getValues(GBuffer b, void *res)
+{
+	if(_GB_SUCCESS != GB_check(b, "GB_getValues")) {
+		return _GB_INVALID;
+	}
+
+	if(!GB_allSet(b, b->set)) {
+		DEBUG_PRINT("GB_getValues: buffer is not full.\n");
+		return _GB_FAILED;
+	}
+
+	memcpy(res, b->values.raw, b->size * GB_valueSize(b->type));
 	return _GB_SUCCESS;
 }
 
 /**
- * Sets the int32_t value at index [i] to [v]. Throws an error if
- * the buffer is not a int32_t buffer or the index is out of range.
- * Gives a warning if the index was not empty.
+ * Sets all the values of [b] from [val], packed in index order
+ * (GB_valuesSize bytes, no alignment required), and marks them as
+ * set and not delivered.
  */
-//void GB_setLongIntValue(GBuffer b, const int i, const int32_t v)
-//{
-//	if(NULL == b) {
-//		DEBUG_PRINT("GB_setLongIntValue: NULL pointer argument.\n");
-//	}
-//
-//	if(_GB_LONG_INT != b->type) {
-//		DEBUG_PRINT("GB_setLongIntValue: type mismatch.\n");
-//	}
-//
-//	if(i >= b->size) {
-//		DEBUG_PRINT("GB_setLongIntValue: index %d out of buffer range %d.\n", i, b->size);
-//	}
-//
-//	if(_GB_STATUS_EMPTY != b->head[i].status) {
-//		WARNING("GB_setLongIntValue: buffer[%d] was already set to %d.\n", i, b->head[i].value.int_value);
-//	}
-//
-//	b->head[i].value.int_value = v;
-//	b->head[i].status = _GB_STATUS_READY;
-//}
+int GB_setValues(GBuffer b, const void * const val)
+{
+	int i;
+
+	if(_GB_SUCCESS != GB_check(b, "GB_setValues")) {
+		return _GB_INVALID;
+	}
+
+	memcpy(b->values.raw, val, b->size * GB_valueSize(b->type));
+	for(i = 0; i < b->words - 1; ++i) {
+		b->set[i] = ~0ULL;
+		b->delivered[i] = 0;
+	}
+	b->set[i] = b->last_mask;
+	b->delivered[i] = 0;
+	return _GB_SUCCESS;
+}
 
 /************************************************************
 * Empty buffer utiliy function
@@ -271,10 +279,7 @@ int GB_empty(GBuffer b)
 		return _GB_INVALID;
 	}
 
-	int i;
-	for(i = 0; i < b->size; ++i) {
-		GB_unset(b, i);
-	}
+	memset(b->set, 0, 2 * b->words * sizeof (uint64_t));
 	return _GB_SUCCESS;
 }
 
@@ -288,43 +293,34 @@ int GB_empty(GBuffer b)
  */
 int GB_set(GBuffer b, const int i)
 {
-	if(_GB_SUCCESS != GB_check(b, "GB_set")) {
-		return _GB_INVALID;
-	}
+	int rv;
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_set: index %d out of buffer range %d.\n", i, b->size);
-		return _GB_FAILED;
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_set"))) {
+		return rv;
 	}
 
-	if(_GB_STATUS_EMPTY != b->head[i].status) {
+	if(b->set[_GB_WORD(i)] & _GB_BIT(i)) {
 		WARNING("GB_set: buffer[%d] was already set.\n", i);
 	}
 
-	b->head[i].status = _GB_STATUS_READY;
+	b->set[_GB_WORD(i)] |= _GB_BIT(i);
+	b->delivered[_GB_WORD(i)] &= ~_GB_BIT(i);
 	return _GB_SUCCESS;
 }
 
 /**
- * Marks the index [i] as empty. Gives a warning if the index was
- * already empty.
+ * Marks the index [i] as empty.
  */
 int GB_unset(GBuffer b, const int i)
 {
-	if(_GB_SUCCESS != GB_check(b, "GB_unset")) {
-		return _GB_INVALID;
-	}
+	int rv;
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_unset: index %d out of buffer range %d.\n", i, b->size);
-		return _GB_FAILED;
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_unset"))) {
+		return rv;
 	}
 
-//	if(_GB_STATUS_EMPTY == b->head[i].status) {
-//		WARNING("GB_unset: buffer[%d] was already empty.\n", i);
-//	}
-
-	b->head[i].status = _GB_STATUS_EMPTY;
+	b->set[_GB_WORD(i)] &= ~_GB_BIT(i);
+	b->delivered[_GB_WORD(i)] &= ~_GB_BIT(i);
 	return _GB_SUCCESS;
 }
 
@@ -334,23 +330,23 @@ int GB_unset(GBuffer b, const int i)
  */
 int GB_markAsDelivered(GBuffer b, const int i)
 {
-	if(_GB_SUCCESS != GB_check(b, "GB_markAsDelivered")) {
-		return _GB_INVALID;
-	}
+	int rv;
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_markAsDelivered: index %d out of buffer range %d.\n", i, b->size);
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_markAsDelivered"))) {
+		return rv;
 	}
 
-	if(_GB_STATUS_EMPTY == b->head[i].status) {
+	if(!(b->set[_GB_WORD(i)] & _GB_BIT(i))) {
 		WARNING("GB_markAsDelivered: buffer[%d] was not set.\n", i);
 	}
 
-	if(_GB_STATUS_DELIVERED == b->head[i].status) {
+	if(b->delivered[_GB_WORD(i)] & _GB_BIT(i)) {
 		WARNING("GB_markAsDelivered: buffer[%d] was already marked as delivered.\n", i);
 	}
 
-	b->head[i].status = _GB_STATUS_DELIVERED;
+	/* Delivered implies set. */
+	b->set[_GB_WORD(i)] |= _GB_BIT(i);
+	b->delivered[_GB_WORD(i)] |= _GB_BIT(i);
 
 	return _GB_SUCCESS;
 }
@@ -364,15 +360,13 @@ int GB_markAsDelivered(GBuffer b, const int i)
  */
 int GB_isSet(GBuffer b, const int i)
 {
-	if(_GB_SUCCESS != GB_check(b, "GB_isSet")) {
-		return _GB_INVALID;
-	}
+	int rv;
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_isSet: index %d out of buffer range %d.\n", i, b->size);
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_isSet"))) {
+		return rv;
 	}
 
-	return b->head[i].status != _GB_STATUS_EMPTY;
+	return 0 != (b->set[_GB_WORD(i)] & _GB_BIT(i));
 }
 
 /**
@@ -381,15 +375,13 @@ int GB_isSet(GBuffer b, const int i)
  */
 int GB_isDelivered(GBuffer b, const int i)
 {
-	if(_GB_SUCCESS != GB_check(b, "GB_isDelivered")) {
-		return _GB_INVALID;
-	}
+	int rv;
 
-	if(i >= b->size) {
-		DEBUG_PRINT("GB_isDelivered: index %d out of buffer range %d.\n", i, b->size);
+	if(_GB_SUCCESS != (rv = GB_checkIndex(b, i, "GB_isDelivered"))) {
+		return rv;
 	}
 
-	return b->head[i].status == _GB_STATUS_DELIVERED;
+	return 0 != (b->delivered[_GB_WORD(i)] & _GB_BIT(i));
 }
 
 /************************************************************
@@ -406,13 +398,7 @@ int GB_isFull(GBuffer b)
 		return _GB_INVALID;
 	}
 
-	int ret = 1, i;
-
-	for(i = 0; i < b->size; ++i) {
-		ret &= (b->head[i].status != _GB_STATUS_EMPTY);
-	}
-
-	return ret;
+	return GB_allSet(b, b->set);
 }
 
 /**
@@ -425,13 +411,15 @@ int GB_isEmpty(GBuffer b)
 		return _GB_INVALID;
 	}
 
-	int ret = 1, i;
+	int i;
 
-	for(i = 0; i < b->size; ++i) {
-		ret &= (b->head[i].status == _GB_STATUS_EMPTY);
+	for(i = 0; i < b->words; ++i) {
+		if(0 != b->set[i]) {
+			return 0;
+		}
 	}
 
-	return ret;
+	return 1;
 }
 
 /**
@@ -444,13 +432,24 @@ int GB_isAllDelivered(GBuffer b)
 		return _GB_INVALID;
 	}
 
-	int ret = 1, i;
+	return GB_allSet(b, b->delivered);
+}
 
-	for(i = 0; i < b->size; ++i) {
-		ret &= (_GB_STATUS_DELIVERED == b->head[i].status);
+/**
+ * Returns 1 if every index of [b] has its bit set in [bits],
+ * 0 otherwise. A single compare for buffers up to 64 indexes.
+ */
+static int GB_allSet(GBuffer b, const uint64_t * const bits)
+{
+	int i;
+
+	for(i = 0; i < b->words - 1; ++i) {
+		if(~0ULL != bits[i]) {
+			return 0;
+		}
 	}
 
-	return ret;
+	return b->last_mask == (bits[i] & b->last_mask);
 }
 
 /************************************************************
@@ -487,6 +486,9 @@ int GB_print(GBuffer b, PrintFunction f)
 		case _GB_LONG_INT:
 			snprintf(header, 100, "=== GeneralBuffer<%s>[%d] ===", "LongInt", b->size);
 			break;
+		case _GB_FLOAT:
+			snprintf(header, 100, "=== GeneralBuffer<%s>[%d] ===", "Float", b->size);
+			break;
 		default:
 			DEBUG_PRINT("GB_print: buffer type not recognized, this should not have happened.\n");
 			free(header);
@@ -496,22 +498,26 @@ int GB_print(GBuffer b, PrintFunction f)
 	DEBUG_PRINT("\n%s\n", header);
 
 	for(i = 0; i < b->size; ++i) {
-		if(_GB_STATUS_EMPTY == b->head[i].status) {
+		if(!(b->set[_GB_WORD(i)] & _GB_BIT(i))) {
 			DEBUG_PRINT("[%s]: (empty)\n", f(i));
 		}
 		else {
 			switch(b->type) {
 				case _GB_DOUBLE:
-					DEBUG_PRINT("[%s]: %.8e", f(i), b->head[i].value.double_value);
+					DEBUG_PRINT("[%s]: %.8e", f(i), b->values.double_values[i]);
 					break;
 				case _GB_LONG_INT:
-					DEBUG_PRINT("[%s]: %d", f(i), b->head[i].value.int_value);
+					DEBUG_PRINT("[%s]: %d", f(i), b->values.int_values[i]);
+					break;
+				case _GB_FLOAT:
+					DEBUG_PRINT("[%s]: %.8e", f(i), b->values.float_values[i]);
 					break;
 				default:
 					DEBUG_PRINT("GB_print: buffer type not recognized, this should not have happened.\n");
+					free(header);
 					return _GB_INVALID;
 			}
-			DEBUG_PRINT("%s\n", (_GB_STATUS_DELIVERED == b->head[i].status) ? " (delivered)" : "");
+			DEBUG_PRINT("%s\n", (b->delivered[_GB_WORD(i)] & _GB_BIT(i)) ? " (delivered)" : "");
 		}
 	}
 
@@ -523,103 +529,22 @@ int GB_print(GBuffer b, PrintFunction f)
 	return _GB_SUCCESS;
 }
 
-//void GB_printDecorated(GBuffer b)
-//{
-//	if(_GB_SUCCESS != GB_check(b, "GB_getValue")) {
-//		return _GB_INVALID;
-//	}
-//	if(_GB_DOUBLE == b->type) {
-//		GB_printBufferDoubleDecorated(b, f);
-//	}
-//	else {
-//		GB_printBufferLongIntDecorated(b, f);
-//	}
-//}
-//
-//static void GB_printBufferDouble(GBuffer b)
-//{
-//	if(NULL == b) {
-//		DEBUG_PRINT("GB_printBufferDouble: NULL pointer argument.\n");
-//	}
-//
-//	int i;
-//
-//	DEBUG_PRINT("\n=== GeneralBuffer<Double>[%d] ===\n", b->size);
-//	for(i = 0; i < b->size; ++i) {
-//		if(b->head[i].status == _GB_STATUS_EMPTY) {
-//			DEBUG_PRINT("[%d]: (empty)\n", i);
-//		}
-//		else {
-//			DEBUG_PRINT("[%d]: %.8e%s\n", i, b->head[i].value.double_value, (b->head[i].status == _GB_STATUS_DELIVERED) ? " (delivered)" : "");
-//		}
-//	}
-//	DEBUG_PRINT("================================\n\n");
-//}
-//
-//static void GB_printBufferLongInt(GBuffer b)
-//{
-//	if(NULL == b) {
-//		DEBUG_PRINT("GB_printBufferLongInt: NULL pointer argument.\n");
-//	}
-//
-//	int i;
-//
-//	DEBUG_PRINT("\n=== GeneralBuffer<LongInt>[%d] ===\n", b->size);
-//	for(i = 0; i < b->size; ++i) {
-//		if(b->head[i].status == _GB_STATUS_EMPTY) {
-//			DEBUG_PRINT("[%d]: (empty)\n", i);
-//		}
-//		else {
-//			DEBUG_PRINT("[%d]: %ld%s\n", i, b->head[i].value.int_value, (b->head[i].status == _GB_STATUS_DELIVERED) ? " (delivered)" : "");
-//		}
-//	}
-//	DEBUG_PRINT("=================================\n\n");
-//}
-//
-//static void GB_printBufferDoubleDecorated(GBuffer b, PrintFunction f)
-//{
-//	if((NULL == b) || (NULL == f)) {
-//		DEBUG_PRINT("GB_printBufferDouble: NULL pointer argument.\n");
-//	}
-//
-//	int i;
-//
-//	DEBUG_PRINT("\n=== GeneralBuffer<Double>[%d] ===\n", b->size);
-//	for(i = 0; i < b->size; ++i) {
-//		if(b->head[i].status == _GB_STATUS_EMPTY) {
-//			DEBUG_PRINT("\"%s\": (empty)\n", f(i));
-//		}
-//		else {
-//			DEBUG_PRINT("\"%s\": %.8e%s\n", f(i), b->head[i].value.double_value, (b->head[i].status == _GB_STATUS_DELIVERED) ? " (delivered)" : "");
-//		}
-//	}
-//	DEBUG_PRINT("================================\n\n");
-//}
-//
-//static void GB_printBufferLongIntDecorated(GBuffer b, PrintFunction f)
-//{
-//	if((NULL == b) || (NULL == f)) {
-//		DEBUG_PRINT("GB_printBufferLongInt: NULL pointer argument.\n");
-//	}
-//
-//	int i;
-//
-//	DEBUG_PRINT("\n=== GeneralBuffer<LongInt>[%d] ===\n", b->size);
-//	for(i = 0; i < b->size; ++i) {
-//		if(b->head[i].status == _GB_STATUS_EMPTY) {
-//			DEBUG_PRINT("\"%s\": (empty)\n", f(i));
-//		}
-//		else {
-//			DEBUG_PRINT("\"%s\": %ld%s\n", f(i), b->head[i].value.int_value, (b->head[i].status == _GB_STATUS_DELIVERED) ? " (delivered)" : "");
-//		}
-//	}
-//	DEBUG_PRINT("=================================\n\n");
-//}
+static size_t GB_valueSize(const enum _GB_type type)
+{
+	switch(type) {
+		case _GB_LONG_INT:
+			return sizeof (int32_t);
+		case _GB_FLOAT:
+			return sizeof (float);
+		default:
+			return sizeof (double);
+	}
+}
 
 static int GB_check(GBuffer b, const char * const fname)
 {
 
-	if((NULL == b) || (NULL == b->head)) {
+	if((NULL == b) || (NULL == b->values.raw) || (NULL == b->set)) {
 		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
 		return _GB_INVALID;
 	}
@@ -637,3 +562,19 @@ static int GB_check(GBuffer b, const char * const fname)
 	return _GB_SUCCESS;
 }
 
+/**
+ * GB_check, plus the range of the index [i].
+ */
+static int GB_checkIndex(GBuffer b, const int i, const char * const fname)
+{
+	if(_GB_SUCCESS != GB_check(b, fname)) {
+		return _GB_INVALID;
+	}
+
+	if((0 > i) || (i >= b->size)) {
+		DEBUG_PRINT("%s: index %d out of buffer range %d.\n", fname, i, b->size);
+		return _GB_FAILED;
+	}
+
+	return _GB_SUCCESS;
+}
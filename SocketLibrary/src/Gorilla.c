@@ -0,0 +1,419 @@
+#include <Gorilla.h>
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _GORILLA_SUCCESS	0
+#define _GORILLA_INVALID	-1
+#define _GORILLA_FAILED		-2
+
+/* Longest codes, in bits: a control written in full, and a
+ * value with a new window and all 64 bits meaningful. */
+#define _GORILLA_CONTROL_BITS	(3 + 32)
+#define _GORILLA_VALUE_BITS	(2 + 5 + 6 + 64)
+
+/* Leading zeros are coded on 5 bits. */
+#define _GORILLA_MAX_LEADING	31
+
+/************************************************************
+* Local structs
+************************************************************/
+
+struct _gorilla {
+	int series;
+	int32_t control;
+	int64_t delta;
+	/* Per series: previous value, and window of its last
+	 * meaningful bits, leading at 64 until there is one. */
+	uint64_t *values;
+	uint8_t *leading;
+	uint8_t *trailing;
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static int bits_put(struct gorilla_stream *b, const uint64_t value, const int count);
+static int bits_put64(struct gorilla_stream *b, const uint64_t value, const int count);
+static int bits_get(struct gorilla_stream *b, uint64_t *value, const int count);
+static int bits_get64(struct gorilla_stream *b, uint64_t *value, const int count);
+static int64_t sign_extend(const uint64_t value, const int count);
+static int gorilla_check(const Gorilla g, const int series, const char * const fname);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+/**
+ * Returns a codec for hours of [series] values, NULL on failure.
+ */
+Gorilla gorilla_init(const int series)
+{
+	if (0 >= series) {
+		DEBUG_PRINT("gorilla_init: invalid series %d.\n", series);
+		return NULL;
+	}
+
+	struct _gorilla *ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("gorilla_init: calloc failed.\n");
+		return NULL;
+	}
+	ret->series = series;
+	ret->values = malloc(series * sizeof(uint64_t));
+	ret->leading = malloc(series);
+	ret->trailing = malloc(series);
+	if ((NULL == ret->values) || (NULL == ret->leading) || (NULL == ret->trailing)) {
+		DEBUG_PRINT("gorilla_init: malloc failed.\n");
+		gorilla_destroy(ret);
+		return NULL;
+	}
+
+	gorilla_reset(ret);
+	return ret;
+}
+
+void gorilla_destroy(Gorilla g)
+{
+	if (NULL == g) {
+		return;
+	}
+	free(g->values);
+	free(g->leading);
+	free(g->trailing);
+	free(g);
+}
+
+/**
+ * Forgets the previous hours: the next control and values are
+ * coded against 0.
+ */
+void gorilla_reset(Gorilla g)
+{
+	if (NULL == g) {
+		return;
+	}
+	g->control = 0;
+	g->delta = 0;
+	memset(g->values, 0, g->series * sizeof(uint64_t));
+	memset(g->leading, 64, g->series);
+	memset(g->trailing, 0, g->series);
+}
+
+/**
+ * Returns the most bytes an hour of a control and [values]
+ * values takes, whatever the values.
+ */
+size_t gorilla_maxSize(const int values)
+{
+	return (_GORILLA_CONTROL_BITS + (size_t) values * _GORILLA_VALUE_BITS + 7) / 8;
+}
+
+/**
+ * Starts writing or reading the [size] bytes at [data].
+ */
+void gorilla_open(struct gorilla_stream *b, void *data, const size_t size)
+{
+	b->data = data;
+	b->size = size;
+	b->pos = 0;
+	b->acc = 0;
+	b->bits = 0;
+}
+
+/**
+ * Ends a write, padding the last byte with zeros. Returns the
+ * bytes written.
+ */
+size_t gorilla_close(struct gorilla_stream *b)
+{
+	if ((0 < b->bits) && (b->pos < b->size)) {
+		b->data[b->pos++] = (uint8_t) (b->acc << (8 - b->bits));
+		b->bits = 0;
+	}
+	return b->pos;
+}
+
+/**
+ * Writes [control] to [b]: '0' if it follows the previous
+ * controls at the same pace, '10' or '110' and the change of
+ * pace on 7 or 12 bits, '111' and the control itself otherwise.
+ */
+int gorilla_putControl(Gorilla g, struct gorilla_stream *b, const int32_t control)
+{
+	if (_GORILLA_SUCCESS != gorilla_check(g, 0, "gorilla_putControl")) {
+		return _GORILLA_INVALID;
+	}
+
+	int64_t delta = (int64_t) control - g->control, dod = delta - g->delta;
+	int rv;
+
+	if (0 == dod) {
+		rv = bits_put(b, 0, 1);
+	}
+	else if ((-64 <= dod) && (63 >= dod)) {
+		rv = bits_put(b, 2, 2) || bits_put(b, (uint64_t) dod, 7);
+	}
+	else if ((-2048 <= dod) && (2047 >= dod)) {
+		rv = bits_put(b, 6, 3) || bits_put(b, (uint64_t) dod, 12);
+	}
+	else {
+		rv = bits_put(b, 7, 3) || bits_put(b, (uint32_t) control, 32);
+	}
+	if (rv) {
+		return _GORILLA_FAILED;
+	}
+
+	g->control = control;
+	g->delta = delta;
+	return _GORILLA_SUCCESS;
+}
+
+/**
+ * Writes [value] of [series] to [b]: '0' if it did not change,
+ * '10' and the bits of its XOR with the previous value within
+ * the previous window, or '11', the new window and its bits.
+ */
+int gorilla_putValue(Gorilla g, struct gorilla_stream *b, const int series, const double value)
+{
+	if (_GORILLA_SUCCESS != gorilla_check(g, series, "gorilla_putValue")) {
+		return _GORILLA_INVALID;
+	}
+
+	uint64_t bits, x;
+	int leading, trailing, meaningful, rv;
+
+	memcpy(&bits, &value, sizeof(bits));
+	x = bits ^ g->values[series];
+
+	if (0 == x) {
+		rv = bits_put(b, 0, 1);
+	}
+	else {
+		leading = __builtin_clzll(x);
+		trailing = __builtin_ctzll(x);
+		if (_GORILLA_MAX_LEADING < leading) {
+			leading = _GORILLA_MAX_LEADING;
+		}
+		if ((g->leading[series] <= leading) && (g->trailing[series] <= trailing)) {
+			meaningful = 64 - g->leading[series] - g->trailing[series];
+			rv = bits_put(b, 2, 2) || bits_put64(b, x >> g->trailing[series], meaningful);
+		}
+		else {
+			meaningful = 64 - leading - trailing;
+			rv = bits_put(b, 3, 2) || bits_put(b, leading, 5) || bits_put(b, meaningful - 1, 6) ||
+				bits_put64(b, x >> trailing, meaningful);
+			g->leading[series] = leading;
+			g->trailing[series] = trailing;
+		}
+	}
+	if (rv) {
+		return _GORILLA_FAILED;
+	}
+
+	g->values[series] = bits;
+	return _GORILLA_SUCCESS;
+}
+
+/**
+ * Reads a control written by gorilla_putControl from [b].
+ */
+int gorilla_getControl(Gorilla g, struct gorilla_stream *b, int32_t *control)
+{
+	if ((_GORILLA_SUCCESS != gorilla_check(g, 0, "gorilla_getControl")) || (NULL == control)) {
+		return _GORILLA_INVALID;
+	}
+
+	uint64_t code, field;
+	int64_t delta;
+
+	if (bits_get(b, &code, 1)) {
+		return _GORILLA_FAILED;
+	}
+	if (0 == code) {
+		delta = g->delta;
+	}
+	else {
+		if (bits_get(b, &code, 1)) {
+			return _GORILLA_FAILED;
+		}
+		if (0 == code) {
+			if (bits_get(b, &field, 7)) {
+				return _GORILLA_FAILED;
+			}
+			delta = g->delta + sign_extend(field, 7);
+		}
+		else {
+			if (bits_get(b, &code, 1)) {
+				return _GORILLA_FAILED;
+			}
+			if (0 == code) {
+				if (bits_get(b, &field, 12)) {
+					return _GORILLA_FAILED;
+				}
+				delta = g->delta + sign_extend(field, 12);
+			}
+			else {
+				if (bits_get(b, &field, 32)) {
+					return _GORILLA_FAILED;
+				}
+				delta = (int64_t) (int32_t) (uint32_t) field - g->control;
+			}
+		}
+	}
+
+	g->control = (int32_t) (g->control + delta);
+	g->delta = delta;
+	*control = g->control;
+	return _GORILLA_SUCCESS;
+}
+
+/**
+ * Reads a value of [series] written by gorilla_putValue from [b].
+ */
+int gorilla_getValue(Gorilla g, struct gorilla_stream *b, const int series, double *value)
+{
+	if ((_GORILLA_SUCCESS != gorilla_check(g, series, "gorilla_getValue")) || (NULL == value)) {
+		return _GORILLA_INVALID;
+	}
+
+	uint64_t code, field, x;
+	int meaningful;
+
+	if (bits_get(b, &code, 1)) {
+		return _GORILLA_FAILED;
+	}
+	if (0 != code) {
+		if (bits_get(b, &code, 1)) {
+			return _GORILLA_FAILED;
+		}
+		if (0 != code) {
+			if (bits_get(b, &field, 5)) {
+				return _GORILLA_FAILED;
+			}
+			g->leading[series] = (uint8_t) field;
+			if (bits_get(b, &field, 6)) {
+				return _GORILLA_FAILED;
+			}
+			if (64 < g->leading[series] + field + 1) {
+				DEBUG_PRINT("gorilla_getValue: invalid window.\n");
+				return _GORILLA_FAILED;
+			}
+			g->trailing[series] = (uint8_t) (64 - g->leading[series] - (field + 1));
+		}
+		else if (64 <= g->leading[series]) {
+			DEBUG_PRINT("gorilla_getValue: no window to reuse.\n");
+			return _GORILLA_FAILED;
+		}
+		meaningful = 64 - g->leading[series] - g->trailing[series];
+		if (bits_get64(b, &x, meaningful)) {
+			return _GORILLA_FAILED;
+		}
+		g->values[series] ^= x << g->trailing[series];
+	}
+
+	memcpy(value, &g->values[series], sizeof(double));
+	return _GORILLA_SUCCESS;
+}
+
+/************************************************************
+* Local functions definition
+************************************************************/
+
+/**
+ * Appends the [count] low bits of [value] to [b], [count] being
+ * at most 32. Fails if [b] is full.
+ */
+static int bits_put(struct gorilla_stream *b, const uint64_t value, const int count)
+{
+	b->acc = (b->acc << count) | (value & ((1ULL << count) - 1));
+	b->bits += count;
+	while (8 <= b->bits) {
+		if (b->size <= b->pos) {
+			DEBUG_PRINT("gorilla: stream full.\n");
+			return _GORILLA_FAILED;
+		}
+		b->bits -= 8;
+		b->data[b->pos++] = (uint8_t) (b->acc >> b->bits);
+	}
+	return _GORILLA_SUCCESS;
+}
+
+/**
+ * bits_put for up to 64 bits.
+ */
+static int bits_put64(struct gorilla_stream *b, const uint64_t value, const int count)
+{
+	if (32 < count) {
+		return bits_put(b, value >> 32, count - 32) || bits_put(b, value, 32);
+	}
+	return bits_put(b, value, count);
+}
+
+/**
+ * Reads the next [count] bits of [b] to [value], [count] being
+ * at most 32. Fails past the end of [b].
+ */
+static int bits_get(struct gorilla_stream *b, uint64_t *value, const int count)
+{
+	while (b->bits < count) {
+		if (b->size <= b->pos) {
+			DEBUG_PRINT("gorilla: stream truncated.\n");
+			return _GORILLA_FAILED;
+		}
+		b->acc = (b->acc << 8) | b->data[b->pos++];
+		b->bits += 8;
+	}
+	b->bits -= count;
+	*value = (b->acc >> b->bits) & ((1ULL << count) - 1);
+	return _GORILLA_SUCCESS;
+}
+
+/**
+ * bits_get for up to 64 bits.
+ */
+static int bits_get64(struct gorilla_stream *b, uint64_t *value, const int count)
+{
+	uint64_t high, low;
+
+	if (32 < count) {
+		if (bits_get(b, &high, count - 32) || bits_get(b, &low, 32)) {
+			return _GORILLA_FAILED;
+		}
+		*value = (high << 32) | low;
+		return _GORILLA_SUCCESS;
+	}
+	return bits_get(b, value, count);
+}
+
+/**
+ * Returns the [count] bits two's complement [value], as a signed
+ * integer.
+ */
+static int64_t sign_extend(const uint64_t value, const int count)
+{
+	uint64_t sign = 1ULL << (count - 1);
+
+	return (int64_t) ((value ^ sign) - sign);
+}
+
+static int gorilla_check(const Gorilla g, const int series, const char * const fname)
+{
+	if (NULL == g) {
+		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
+		return _GORILLA_INVALID;
+	}
+	if ((0 > series) || (g->series <= series)) {
+		DEBUG_PRINT("%s: series %d is not valid.\n", fname, series);
+		return _GORILLA_INVALID;
+	}
+	return _GORILLA_SUCCESS;
+}
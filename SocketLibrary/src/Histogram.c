@@ -0,0 +1,154 @@
+#include <Histogram.h>
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _HIST_SUCCESS	0
+#define _HIST_INVALID	-1
+
+/* Values below _HIST_SUB_COUNT have a bucket each; above, each
+ * power of two is split in _HIST_HALF_COUNT buckets. */
+#define _HIST_SUB_BITS		5
+#define _HIST_SUB_COUNT		(1ULL << _HIST_SUB_BITS)
+#define _HIST_HALF_COUNT	(_HIST_SUB_COUNT / 2)
+/* Index of HIST_MAX_VALUE, plus one. */
+#define _HIST_BUCKETS		((41 - _HIST_SUB_BITS + 2) * _HIST_HALF_COUNT)
+
+/************************************************************
+* Local structs
+************************************************************/
+
+struct _histogram {
+	unsigned long long count;
+	unsigned long long max;
+	unsigned long long buckets[_HIST_BUCKETS];
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static unsigned int hist_index(unsigned long long value);
+static unsigned long long hist_highest(const unsigned int index);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+Histogram hist_init(void)
+{
+	return calloc(1, sizeof(struct _histogram));
+}
+
+void hist_destroy(Histogram h)
+{
+	free(h);
+}
+
+/**
+ * Counts [value] in [h].
+ */
+int hist_record(Histogram h, const unsigned long long value)
+{
+	if (NULL == h) {
+		DEBUG_PRINT("hist_record: NULL pointer argument.\n");
+		return _HIST_INVALID;
+	}
+	++h->buckets[hist_index(value)];
+	++h->count;
+	if (value > h->max) {
+		h->max = value;
+	}
+	return _HIST_SUCCESS;
+}
+
+unsigned long long hist_count(const Histogram h)
+{
+	return (NULL == h) ? 0 : h->count;
+}
+
+unsigned long long hist_max(const Histogram h)
+{
+	return (NULL == h) ? 0 : h->max;
+}
+
+/**
+ * Returns the value below which [percentile] percent of the
+ * recorded values fall, rounded up to its bucket, 0 if [h] is
+ * empty.
+ */
+unsigned long long hist_percentile(const Histogram h, const double percentile)
+{
+	if ((NULL == h) || (0 == h->count)) {
+		return 0;
+	}
+
+	unsigned long long rank = (unsigned long long) ((percentile / 100.0) * h->count + 0.5),
+			  seen = 0, highest;
+	unsigned int index;
+
+	if (1 > rank) {
+		rank = 1;
+	}
+	for (index = 0; index < _HIST_BUCKETS; ++index) {
+		seen += h->buckets[index];
+		if (seen >= rank) {
+			break;
+		}
+	}
+	highest = hist_highest(index);
+	return (highest > h->max) ? h->max : highest;
+}
+
+/**
+ * Prints the summary of [h], values in [unit], on a single line.
+ */
+void hist_print(const Histogram h, const char * const name, const char * const unit)
+{
+	if (0 == hist_count(h)) {
+		WARNING("%s: no samples.\n", name);
+		return;
+	}
+	WARNING("%s: %llu samples, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu %s.\n",
+		name, h->count,
+		hist_percentile(h, 50.0), hist_percentile(h, 90.0), hist_percentile(h, 99.0),
+		hist_percentile(h, 99.9), h->max, unit);
+}
+
+/**
+ * Returns the bucket counting [value].
+ */
+static unsigned int hist_index(unsigned long long value)
+{
+	unsigned int shift;
+
+	if (HIST_MAX_VALUE < value) {
+		value = HIST_MAX_VALUE;
+	}
+	if (_HIST_SUB_COUNT > value) {
+		return (unsigned int) value;
+	}
+	/* Keeps the _HIST_SUB_BITS most significant bits. */
+	shift = 64 - __builtin_clzll(value) - _HIST_SUB_BITS;
+	return shift * _HIST_HALF_COUNT + (unsigned int) (value >> shift);
+}
+
+/**
+ * Returns the largest value counted by bucket [index].
+ */
+static unsigned long long hist_highest(const unsigned int index)
+{
+	unsigned int shift;
+
+	if (_HIST_SUB_COUNT > index) {
+		return index;
+	}
+	shift = index / _HIST_HALF_COUNT - 1;
+	return (((unsigned long long) (index - shift * _HIST_HALF_COUNT) + 1) << shift) - 1;
+}
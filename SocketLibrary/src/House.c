@@ -5,99 +5,155 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+
+/************************************************************
+* Local variables
+************************************************************/
+
+/* Schema in use, and the descriptor it was loaded from, empty
+ * for the built-in one. */
+static Schema schema = NULL;
+static char *schema_path = NULL;
+static pthread_mutex_t schema_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static int load_schema(const char * const path);
 
 /************************************************************
 * Function definition
 ************************************************************/
 
-Measures get_MEAS_num_from_name(const char * const name)
+/**
+ * Loads the schema described by the file at [path], or the built-in
+ * one if [path] is NULL or empty. Loading again the schema in use
+ * does nothing.
+ * Returns 0 on success, non-zero if the file isn't a valid
+ * descriptor or another schema is already in use.
+ */
+int house_loadSchema(const char * const path)
 {
-	if(NULL == name) {
-		WARNING("get_MEAS_num_from_name: NULL pointer argument\n");
-		return MEAS_NUMBER;
-	}
+	int ret;
 
-	if((strlen(name) == strlen("energy")) &&
-		(0 == (strncmp(name, "energy", strlen("energy"))))) {
-		return MEAS_ENERGY;
-	}
-	else if((strlen(name) == strlen("consumption")) &&
-		(0 == (strncmp(name, "consumption", strlen("consumption"))))) {
-		return MEAS_CONSUMPTION;
-	}
-	else if((strlen(name) == strlen("production")) &&
-		(0 == (strncmp(name, "production", strlen("production"))))) {
-		return MEAS_PRODUCTION;
-	}
-	else if((strlen(name) == strlen("battery")) &&
-		(0 == (strncmp(name, "battery", strlen("battery"))))) {
-		return MEAS_BATTERY;
-	}
-	else if((strlen(name) == strlen("phev")) &&
-		(0 == (strncmp(name, "phev", strlen("phev"))))) {
-		return MEAS_PHEV;
+	pthread_mutex_lock(&schema_lock);
+	ret = load_schema((NULL == path) ? "" : path);
+	pthread_mutex_unlock(&schema_lock);
+
+	return ret;
+}
+
+/**
+ * Returns non-zero once a schema is in use.
+ */
+int house_hasSchema(void)
+{
+	int ret;
+
+	pthread_mutex_lock(&schema_lock);
+	ret = (NULL != schema);
+	pthread_mutex_unlock(&schema_lock);
+
+	return ret;
+}
+
+/**
+ * Returns the schema in use, the built-in one if none was loaded.
+ */
+Schema house_getSchema(void)
+{
+	Schema ret;
+
+	pthread_mutex_lock(&schema_lock);
+	if (NULL == schema) {
+		load_schema("");
 	}
-	else if((strlen(name) == strlen("phev_ready_hours")) &&
-		(0 == (strncmp(name, "phev_ready_hours", strlen("phev_ready_hours"))))) {
-		return MEAS_PHEV_READY_HOURS;
+	ret = schema;
+	pthread_mutex_unlock(&schema_lock);
+
+	if (NULL == ret) {
+		ERROR("house_getSchema: unable to build the built-in schema.\n");
 	}
-	else {
-		return MEAS_NUMBER;
+	return ret;
+}
+
+/**
+ * Returns the index of the measure [name], -1 if there is none.
+ */
+int get_MEAS_num_from_name(const char * const name)
+{
+	if(NULL == name) {
+		WARNING("get_MEAS_num_from_name: NULL pointer argument\n");
+		return -1;
 	}
+
+	return schema_find(house_getSchema(), SCHEMA_MEAS, name);
 }
 
-Commands get_CMDS_num_from_name(const char * const name)
+/**
+ * Returns the index of the command [name], -1 if there is none.
+ */
+int get_CMDS_num_from_name(const char * const name)
 {
 	if(NULL == name) {
 		WARNING("get_CMDS_num_from_name: NULL pointer argument\n");
-		return CMDS_NUMBER;
+		return -1;
 	}
 
-	if((strlen(name) == strlen("battery")) &&
-	(0 == (strncmp(name, "battery", strlen("battery"))))) {
-		return CMDS_BATTERY;
-	}
-	else if((strlen(name) == strlen("phev")) &&
-	(0 == (strncmp(name, "phev", strlen("phev"))))) {
-		return CMDS_PHEV;
-	}
-	else {
-		return CMDS_NUMBER;
-	}
+	return schema_find(house_getSchema(), SCHEMA_CMDS, name);
 }
 
-
-const char * const get_MEAS_name_from_num(const Measures c)
+const char * const get_MEAS_name_from_num(const int c)
 {
-	switch (c) {
-		case MEAS_ENERGY:
-			return "energy load on grid";
-		case MEAS_CONSUMPTION:
-			return "energy consumption";
-		case MEAS_PRODUCTION:
-			return "energy production";
-		case MEAS_BATTERY:
-			return "battery charge";
-		case MEAS_PHEV:
-			return "PHEV charge";
-		case MEAS_PHEV_READY_HOURS:
-			return "PHEV ready hours";
-		default:
-			WARNING("get_MEAS_name_from_num: measurement type not recognized\n");
-			return "(UNKNOWN)";
+	const char *label = schema_label(house_getSchema(), SCHEMA_MEAS, c);
+
+	if (NULL == label) {
+		WARNING("get_MEAS_name_from_num: measurement type not recognized\n");
+		return "(UNKNOWN)";
 	}
+	return label;
 }
 
-const char * const get_CMDS_name_from_num(const Commands c)
+const char * const get_CMDS_name_from_num(const int c)
 {
-	switch (c) {
-		case CMDS_BATTERY:
-			return "battery charge rate";
-		case CMDS_PHEV:
-			return "PHEV charge rate";
-		default:
-			WARNING("get_MEAS_name_from_num: measurement type not recognized\n");
-			return "(UNKNOWN)";
+	const char *label = schema_label(house_getSchema(), SCHEMA_CMDS, c);
+
+	if (NULL == label) {
+		WARNING("get_CMDS_name_from_num: command type not recognized\n");
+		return "(UNKNOWN)";
 	}
+	return label;
 }
 
+/************************************************************
+* Local functions definition
+************************************************************/
+
+/**
+ * house_loadSchema, with the schema lock held.
+ */
+static int load_schema(const char * const path)
+{
+	if (NULL != schema) {
+		if (0 != strcmp(schema_path, path)) {
+			WARNING("house_loadSchema: schema \"%s\" already in use.\n", schema_path);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (NULL == (schema_path = strdup(path))) {
+		WARNING("house_loadSchema: strdup failed.\n");
+		return -1;
+	}
+	schema = ('\0' == path[0]) ? schema_default() : schema_load(path);
+	if (NULL == schema) {
+		free(schema_path);
+		schema_path = NULL;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,607 @@
+#include <HouseServer.h>
+
+#include <Debug.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _HS_SUCCESS		0
+#define _HS_INVALID		-1
+#define _HS_FAILED		-2
+
+#define _HS_MAX_EVENTS	64
+/* Time a new connection has to send its house ID. */
+#define _HS_PENDING_MILLIS	5000
+
+/************************************************************
+* Local structs
+************************************************************/
+
+enum _hs_kind {
+	_HS_LISTEN = 0,
+	_HS_PENDING,
+	_HS_HOUSE
+};
+
+/* Every fd registered in the epoll instance carries one of these. */
+struct _hs_entry {
+	enum _hs_kind kind;
+	Sockets type;
+	int fd;
+	int armed;
+	int ready;
+	/* Pending connections only: the house ID bytes read so far,
+	 * the time by which it must be complete, and the next pending
+	 * connection. */
+	char id[sizeof(int32_t)];
+	size_t id_len;
+	long long deadline;
+	struct _hs_entry *next;
+};
+
+struct _house_server {
+	int epoll_fd;
+	int houses;
+	struct _hs_entry listen[SOCKET_NUMBER];
+	/* [houses * SOCKET_NUMBER] sockets and their epoll entries */
+	struct socket_singleton *sockets;
+	struct _hs_entry *entries;
+	/* Connections whose house ID is still incomplete. */
+	struct _hs_entry *pending;
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static int HS_check(HouseServer s, const char * const fname);
+
+#ifdef __linux__
+static int HS_pump(HouseServer s, const int timeout);
+static void HS_accept(HouseServer s, struct _hs_entry *listen);
+static void HS_bind(HouseServer s, struct _hs_entry *pending);
+static void HS_drop(HouseServer s, struct _hs_entry *pending);
+static void HS_expire(HouseServer s);
+static int HS_blocking(const int fd, const int blocking);
+static int HS_arm(HouseServer s, struct _hs_entry *e);
+static long long HS_now_millis(void);
+#endif
+
+/************************************************************
+* Function definition
+************************************************************/
+
+#ifdef __linux__
+
+/**
+ * Creates the shared listening sockets and the epoll instance
+ * for [houses] houses. Does not wait for any connection.
+ * Returns NULL on failure.
+ */
+HouseServer HS_create(const unsigned short meas_port, const unsigned short cmds_port, const int houses)
+{
+	if (0 >= houses) {
+		DEBUG_PRINT("HS_create: invalid number of houses %d.\n", houses);
+		return NULL;
+	}
+
+	struct _house_server *ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("HS_create: calloc failed.\n");
+		return NULL;
+	}
+	ret->houses = houses;
+	ret->listen[SOCKET_MEAS].fd = -1;
+	ret->listen[SOCKET_CMDS].fd = -1;
+	ret->epoll_fd = -1;
+
+	ret->sockets = calloc(houses * SOCKET_NUMBER, sizeof(*ret->sockets));
+	ret->entries = calloc(houses * SOCKET_NUMBER, sizeof(*ret->entries));
+	if ((NULL == ret->sockets) || (NULL == ret->entries)) {
+		DEBUG_PRINT("HS_create: calloc failed.\n");
+		HS_destroy(ret);
+		return NULL;
+	}
+
+	int i;
+	for (i = 0; i < houses * SOCKET_NUMBER; ++i) {
+		ret->entries[i].kind = _HS_HOUSE;
+		ret->entries[i].type = i % SOCKET_NUMBER;
+		ret->entries[i].fd = -1;
+	}
+
+	if (0 > (ret->epoll_fd = epoll_create1(0))) {
+		DEBUG_PRINT("HS_create: epoll_create1 failed.\n");
+		HS_destroy(ret);
+		return NULL;
+	}
+
+	ret->listen[SOCKET_MEAS].fd = socketBuilder(meas_port, houses);
+	ret->listen[SOCKET_CMDS].fd = socketBuilder(cmds_port, houses);
+
+	Sockets type;
+	struct epoll_event ev = {0};
+	for (type = 0; type < SOCKET_NUMBER; ++type) {
+		ret->listen[type].kind = _HS_LISTEN;
+		ret->listen[type].type = type;
+		ev.events = EPOLLIN;
+		ev.data.ptr = &ret->listen[type];
+		if ((0 > ret->listen[type].fd) ||
+			(0 > epoll_ctl(ret->epoll_fd, EPOLL_CTL_ADD, ret->listen[type].fd, &ev))) {
+			DEBUG_PRINT("HS_create: unable to listen on socket %d.\n", type);
+			HS_destroy(ret);
+			return NULL;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * Closes every socket owned by the server and frees it.
+ */
+int HS_destroy(HouseServer s)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_destroy")) {
+		return _HS_INVALID;
+	}
+
+	int i;
+	Sockets type;
+
+	for (type = 0; type < SOCKET_NUMBER; ++type) {
+		if (0 <= s->listen[type].fd) {
+			close(s->listen[type].fd);
+		}
+	}
+	while (NULL != s->pending) {
+		HS_drop(s, s->pending);
+	}
+	if ((NULL != s->sockets) && (NULL != s->entries)) {
+		for (i = 0; i < s->houses * SOCKET_NUMBER; ++i) {
+			if (0 <= s->entries[i].fd) {
+				close(s->entries[i].fd);
+			}
+			socket_release(&s->sockets[i]);
+		}
+	}
+	if (0 <= s->epoll_fd) {
+		close(s->epoll_fd);
+	}
+
+	free(s->sockets);
+	free(s->entries);
+	free(s);
+
+	return _HS_SUCCESS;
+}
+
+/**
+ * Waits up to [timeout] milliseconds (forever if negative) for
+ * data to be readable on [socket], which must belong to [s]. While
+ * waiting, accepts new connections and records readiness of every
+ * other house.
+ * Returns 0 if no data can be read, non-zero otherwise.
+ */
+int HS_wait(HouseServer s, struct socket_singleton *socket, const int timeout)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_wait")) {
+		return 0;
+	}
+	if ((socket < s->sockets) || (socket >= s->sockets + s->houses * SOCKET_NUMBER)) {
+		DEBUG_PRINT("HS_wait: socket does not belong to this server.\n");
+		return 0;
+	}
+
+	struct _hs_entry *e = &s->entries[socket - s->sockets];
+	long long deadline = HS_now_millis() + timeout;
+	long long left;
+
+	do {
+		if (e->ready) {
+			e->ready = 0;
+			return 1;
+		}
+		if ((0 <= e->fd) && (!e->armed) && (HS_arm(s, e))) {
+			return 0;
+		}
+		left = (0 > timeout) ? -1 : deadline - HS_now_millis();
+		if ((0 <= timeout) && (0 > left)) {
+			left = 0;
+		}
+		if (0 > HS_pump(s, (int) left)) {
+			return 0;
+		}
+	} while (e->ready || (0 != left));
+
+	return 0;
+}
+
+/**
+ * Closes the connections of [house], if still open, so that new
+ * controller connections can be bound to it.
+ */
+int HS_disconnect(HouseServer s, const int house)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_disconnect")) {
+		return _HS_INVALID;
+	}
+	if ((0 > house) || (s->houses <= house)) {
+		DEBUG_PRINT("HS_disconnect: invalid house %d.\n", house);
+		return _HS_INVALID;
+	}
+
+	int index;
+	for (index = house * SOCKET_NUMBER; index < (house + 1) * SOCKET_NUMBER; ++index) {
+		socket_close(&s->sockets[index]);
+		s->entries[index].fd = -1;
+		s->entries[index].armed = 0;
+		s->entries[index].ready = 0;
+	}
+
+	return _HS_SUCCESS;
+}
+
+/**
+ * Serves pending connections for up to [timeout] milliseconds
+ * (forever if negative), until both sockets of [house] are
+ * connected.
+ * Returns non-zero if they are.
+ */
+int HS_waitHouse(HouseServer s, const int house, const int timeout)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_waitHouse")) {
+		return 0;
+	}
+	if ((0 > house) || (s->houses <= house)) {
+		DEBUG_PRINT("HS_waitHouse: invalid house %d.\n", house);
+		return 0;
+	}
+
+	struct socket_singleton *sockets = &s->sockets[house * SOCKET_NUMBER];
+	long long deadline = HS_now_millis() + timeout;
+	long long left;
+
+	while (!(sockets[SOCKET_MEAS].started && sockets[SOCKET_CMDS].started)) {
+		left = (0 > timeout) ? -1 : deadline - HS_now_millis();
+		if ((0 <= timeout) && (0 >= left)) {
+			return 0;
+		}
+		if (0 > HS_pump(s, (int) left)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/************************************************************
+* Event handling
+************************************************************/
+
+/**
+ * Runs a single epoll_wait, dispatching every returned event. The
+ * wait ends early at the deadline of a pending connection, which
+ * is then dropped.
+ */
+static int HS_pump(HouseServer s, int timeout)
+{
+	struct epoll_event events[_HS_MAX_EVENTS];
+	struct _hs_entry *e;
+	long long left;
+	int n, i;
+
+	for (e = s->pending; NULL != e; e = e->next) {
+		left = e->deadline - HS_now_millis();
+		left = (0 > left) ? 0 : left;
+		if ((0 > timeout) || (left < timeout)) {
+			timeout = (int) left;
+		}
+	}
+
+	n = epoll_wait(s->epoll_fd, events, _HS_MAX_EVENTS, timeout);
+	if (0 > n) {
+		if (EINTR == errno) {
+			return 0;
+		}
+		DEBUG_PRINT("HS_pump: epoll_wait failure.\n");
+		return n;
+	}
+
+	for (i = 0; i < n; ++i) {
+		e = events[i].data.ptr;
+		switch (e->kind) {
+		case _HS_LISTEN:
+			HS_accept(s, e);
+			break;
+		case _HS_PENDING:
+			HS_bind(s, e);
+			break;
+		case _HS_HOUSE:
+			/* One-shot: disarmed until the next HS_wait on it. */
+			e->armed = 0;
+			e->ready = 1;
+			break;
+		}
+	}
+	HS_expire(s);
+
+	return n;
+}
+
+/**
+ * Accepts a connection whose house ID is still unknown.
+ */
+static void HS_accept(HouseServer s, struct _hs_entry *listen)
+{
+	struct epoll_event ev = {0};
+	struct _hs_entry *pending;
+	int fd;
+
+	if (0 > (fd = accept(listen->fd, NULL, NULL))) {
+		WARNING("HS_accept: accept failed on socket %d.\n", listen->type);
+		return;
+	}
+
+	pending = calloc(1, sizeof(*pending));
+	if (NULL == pending) {
+		WARNING("HS_accept: calloc failed.\n");
+		close(fd);
+		return;
+	}
+	pending->kind = _HS_PENDING;
+	pending->type = listen->type;
+	pending->fd = fd;
+	pending->deadline = HS_now_millis() + _HS_PENDING_MILLIS;
+
+	/* The house ID may come in pieces, it must not stall the
+	 * other houses. */
+	ev.events = EPOLLIN;
+	ev.data.ptr = pending;
+	if (HS_blocking(fd, 0) || (0 > epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &ev))) {
+		WARNING("HS_accept: unable to add connection to epoll.\n");
+		close(fd);
+		free(pending);
+		return;
+	}
+	pending->next = s->pending;
+	s->pending = pending;
+	DEBUG_PRINT("HS_accept: accepted connection %d on socket %d.\n", fd, listen->type);
+}
+
+/**
+ * Reads what arrived of the house ID of a pending connection and,
+ * once complete, binds the connection to that house's socket.
+ */
+static void HS_bind(HouseServer s, struct _hs_entry *pending)
+{
+	struct epoll_event ev = {0};
+	struct socket_singleton *socket;
+	struct _hs_entry *e;
+	int32_t house;
+	ssize_t n;
+	int index;
+
+	n = recv(pending->fd, pending->id + pending->id_len, sizeof(pending->id) - pending->id_len, 0);
+	if ((0 > n) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))) {
+		return;
+	}
+	if (0 >= n) {
+		WARNING("HS_bind: unable to read house ID on connection %d.\n", pending->fd);
+		goto drop;
+	}
+	pending->id_len += n;
+	if (sizeof(pending->id) > pending->id_len) {
+		return;
+	}
+
+	memcpy(&house, pending->id, sizeof(house));
+	if ((0 > house) || (s->houses <= house)) {
+		WARNING("HS_bind: invalid house ID %d.\n", house);
+		goto drop;
+	}
+
+	index = house * SOCKET_NUMBER + pending->type;
+	socket = &s->sockets[index];
+	e = &s->entries[index];
+	if (socket->started) {
+		WARNING("HS_bind: house %d socket %d already connected.\n", house, pending->type);
+		goto drop;
+	}
+
+	/* The house reads its socket with blocking calls. */
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.ptr = e;
+	if (HS_blocking(pending->fd, 1) || (0 > epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, pending->fd, &ev))) {
+		WARNING("HS_bind: unable to modify epoll entry.\n");
+		goto drop;
+	}
+
+	e->fd = pending->fd;
+	e->armed = 1;
+	e->ready = 0;
+	socket->accept_fd = pending->fd;
+	socket->started = 1;
+	DEBUG_PRINT("HS_bind: house %d started socket %d.\n", house, pending->type);
+	pending->fd = -1;
+
+drop:
+	HS_drop(s, pending);
+}
+
+/**
+ * Forgets [pending], closing its connection unless it was bound
+ * to a house.
+ */
+static void HS_drop(HouseServer s, struct _hs_entry *pending)
+{
+	struct _hs_entry **link = &s->pending;
+
+	while ((NULL != *link) && (pending != *link)) {
+		link = &(*link)->next;
+	}
+	if (NULL != *link) {
+		*link = pending->next;
+	}
+	if (0 <= pending->fd) {
+		close(pending->fd);
+	}
+	free(pending);
+}
+
+/**
+ * Drops the pending connections that did not send their house ID
+ * in time.
+ */
+static void HS_expire(HouseServer s)
+{
+	struct _hs_entry *e = s->pending, *next;
+	long long now = HS_now_millis();
+
+	for (; NULL != e; e = next) {
+		next = e->next;
+		if (now >= e->deadline) {
+			WARNING("HS_expire: no house ID on connection %d.\n", e->fd);
+			HS_drop(s, e);
+		}
+	}
+}
+
+/**
+ * Makes [fd] [blocking] or not.
+ * Returns 0 on success, non-zero on failure.
+ */
+static int HS_blocking(const int fd, const int blocking)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if (0 > flags) {
+		return _HS_FAILED;
+	}
+	flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+	return (0 > fcntl(fd, F_SETFL, flags)) ? _HS_FAILED : _HS_SUCCESS;
+}
+
+/**
+ * Re-enables the one-shot epoll notification of [e].
+ * Returns 0 on success, non-zero on failure.
+ */
+static int HS_arm(HouseServer s, struct _hs_entry *e)
+{
+	struct epoll_event ev = {0};
+
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.ptr = e;
+	if (0 > epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, e->fd, &ev)) {
+		DEBUG_PRINT("HS_arm: unable to re-arm fd %d.\n", e->fd);
+		return _HS_FAILED;
+	}
+	e->armed = 1;
+	return _HS_SUCCESS;
+}
+
+static long long HS_now_millis(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000LL;
+}
+
+#else /* __linux__ */
+
+HouseServer HS_create(const unsigned short meas_port, const unsigned short cmds_port, const int houses)
+{
+	DEBUG_PRINT("HS_create: epoll is not available on this platform.\n");
+	return NULL;
+}
+
+int HS_destroy(HouseServer s)
+{
+	return _HS_INVALID;
+}
+
+int HS_wait(HouseServer s, struct socket_singleton *socket, const int timeout)
+{
+	return 0;
+}
+
+int HS_disconnect(HouseServer s, const int house)
+{
+	return _HS_INVALID;
+}
+
+int HS_waitHouse(HouseServer s, const int house, const int timeout)
+{
+	return 0;
+}
+
+#endif /* __linux__ */
+
+/************************************************************
+* Accessors
+************************************************************/
+
+/**
+ * Returns the socket pair of house [house], NULL on error.
+ */
+struct socket_singleton *HS_getSockets(HouseServer s, const int house)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_getSockets")) {
+		return NULL;
+	}
+	if ((0 > house) || (s->houses <= house)) {
+		DEBUG_PRINT("HS_getSockets: invalid house %d.\n", house);
+		return NULL;
+	}
+	return &s->sockets[house * SOCKET_NUMBER];
+}
+
+int HS_getHouses(HouseServer s)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_getHouses")) {
+		return 0;
+	}
+	return s->houses;
+}
+
+/**
+ * Returns the port the [type] listening socket is bound to, or -1.
+ */
+int HS_getPort(HouseServer s, const Sockets type)
+{
+	if (_HS_SUCCESS != HS_check(s, "HS_getPort")) {
+		return -1;
+	}
+	if (SOCKET_NUMBER <= type) {
+		DEBUG_PRINT("HS_getPort: invalid socket %d.\n", type);
+		return -1;
+	}
+	return socketPort(s->listen[type].fd);
+}
+
+static int HS_check(HouseServer s, const char * const fname)
+{
+	if (NULL == s) {
+		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
+		return _HS_INVALID;
+	}
+	return _HS_SUCCESS;
+}
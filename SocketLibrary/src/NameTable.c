@@ -0,0 +1,195 @@
+#include <NameTable.h>
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+/* Seeds tried for a table size before doubling it. */
+#define _NAMES_SEEDS		1024
+/* Largest table, in slots. */
+#define _NAMES_MAX_SLOTS	(1 << 20)
+
+/************************************************************
+* Local structs
+************************************************************/
+
+struct name_table {
+	int count;
+	/* Copies of the names, by index. */
+	char **names;
+	/* Index of the name hashed to each slot, -1 if none. */
+	int *slots;
+	uint32_t mask;
+	uint32_t seed;
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static uint32_t names_hash(const char *name, const uint32_t seed);
+static int names_place(NameTable t);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+/**
+ * Returns a table of the [count] distinct [names], or NULL on
+ * failure (duplicate names, out of memory).
+ */
+NameTable names_init(const char * const * const names, const int count)
+{
+	int i;
+
+	if ((NULL == names) || (0 >= count)) {
+		DEBUG_PRINT("names_init: no names.\n");
+		return NULL;
+	}
+
+	struct name_table *ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("names_init: calloc failed.\n");
+		return NULL;
+	}
+	ret->count = count;
+	if (NULL == (ret->names = calloc(count, sizeof(char *)))) {
+		DEBUG_PRINT("names_init: calloc failed.\n");
+		names_destroy(ret);
+		return NULL;
+	}
+	for (i = 0; i < count; ++i) {
+		if ((NULL == names[i]) || (NULL == (ret->names[i] = strdup(names[i])))) {
+			DEBUG_PRINT("names_init: unable to copy name %d.\n", i);
+			names_destroy(ret);
+			return NULL;
+		}
+	}
+
+	if (names_place(ret)) {
+		names_destroy(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+void names_destroy(NameTable t)
+{
+	int i;
+
+	if (NULL == t) {
+		return;
+	}
+	if (NULL != t->names) {
+		for (i = 0; i < t->count; ++i) {
+			free(t->names[i]);
+		}
+	}
+	free(t->names);
+	free(t->slots);
+	free(t);
+}
+
+/**
+ * Returns the index of [name] in [t], -1 if it is not there.
+ */
+int names_find(const NameTable t, const char * const name)
+{
+	int index;
+
+	if ((NULL == t) || (NULL == name)) {
+		DEBUG_PRINT("names_find: NULL pointer argument.\n");
+		return -1;
+	}
+
+	index = t->slots[names_hash(name, t->seed) & t->mask];
+	if ((0 > index) || (0 != strcmp(t->names[index], name))) {
+		return -1;
+	}
+	return index;
+}
+
+int names_count(const NameTable t)
+{
+	return (NULL == t) ? 0 : t->count;
+}
+
+/**
+ * Returns the name at [index] in [t], NULL if out of range.
+ */
+const char *names_get(const NameTable t, const int index)
+{
+	if ((NULL == t) || (0 > index) || (t->count <= index)) {
+		return NULL;
+	}
+	return t->names[index];
+}
+
+/**
+ * FNV-1a, starting from [seed].
+ */
+static uint32_t names_hash(const char *name, const uint32_t seed)
+{
+	uint32_t h = 2166136261u ^ seed;
+
+	for (; '\0' != *name; ++name) {
+		h ^= (unsigned char) *name;
+		h *= 16777619u;
+	}
+	/* Final mix, so that the low bits depend on every byte. */
+	h ^= h >> 15;
+	h *= 0x2c1b3c6du;
+	h ^= h >> 12;
+	return h;
+}
+
+/**
+ * Looks for a table size and a seed that give each name of [t]
+ * a slot of its own. Starts from twice as many slots as names.
+ * Equal names always collide, and fail as soon as they do.
+ */
+static int names_place(NameTable t)
+{
+	uint32_t slots, seed;
+	int i, *slot;
+
+	for (slots = 4; slots < 2 * (uint32_t) t->count; slots *= 2);
+
+	for (; slots <= _NAMES_MAX_SLOTS; slots *= 2) {
+		free(t->slots);
+		if (NULL == (t->slots = malloc(slots * sizeof(int)))) {
+			DEBUG_PRINT("names_init: malloc failed.\n");
+			return -1;
+		}
+		t->mask = slots - 1;
+		for (seed = 0; seed < _NAMES_SEEDS; ++seed) {
+			memset(t->slots, -1, slots * sizeof(int));
+			for (i = 0; i < t->count; ++i) {
+				slot = &t->slots[names_hash(t->names[i], seed) & t->mask];
+				if (0 <= *slot) {
+					if (0 == strcmp(t->names[*slot], t->names[i])) {
+						DEBUG_PRINT("names_init: duplicate name %s.\n", t->names[i]);
+						return -1;
+					}
+					break;
+				}
+				*slot = i;
+			}
+			if (t->count == i) {
+				t->seed = seed;
+				return 0;
+			}
+		}
+	}
+
+	DEBUG_PRINT("names_init: no perfect hash for %d names.\n", t->count);
+	return -1;
+}
@@ -0,0 +1,407 @@
+#include <Schema.h>
+
+#include <Debug.h>
+#include <NameTable.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+/* Longest descriptor line, comments included. */
+#define _SCHEMA_LINE_LENGTH	256
+
+/************************************************************
+* Local structs
+************************************************************/
+
+struct schema_entries {
+	int count;
+	/* Names, by index, and the perfect hash over them. */
+	char **names;
+	char **labels;
+	/* Reporting rate, in intervals. */
+	int *every;
+	NameTable table;
+};
+
+struct house_schema {
+	struct schema_entries entries[SCHEMA_KIND_NUMBER];
+	/* Non-zero if a measure isn't due every interval. */
+	int multirate;
+};
+
+/************************************************************
+* Local variables
+************************************************************/
+
+static const char * const kind_names[SCHEMA_KIND_NUMBER] = { "meas", "cmds" };
+
+/* The built-in schema, in the order of the Measures and
+ * Commands enums. */
+static const char * const default_names[SCHEMA_KIND_NUMBER][7] = {
+	{ "energy", "consumption", "production", "battery", "phev", "phev_ready_hours", NULL },
+	{ "battery", "phev", NULL }
+};
+static const char * const default_labels[SCHEMA_KIND_NUMBER][7] = {
+	{ "energy load on grid", "energy consumption", "energy production", "battery charge",
+		"PHEV charge", "PHEV ready hours", NULL },
+	{ "battery charge rate", "PHEV charge rate", NULL }
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static int schema_add(Schema s, const SchemaKinds kind, const char * const name, const char * const label, const int every);
+static int schema_build(Schema s);
+static int schema_parseLine(Schema s, char *line, const char * const path, const int number);
+static int schema_check(const Schema s, const SchemaKinds kind, const char * const fname);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+/**
+ * Returns a new copy of the built-in schema, NULL on failure.
+ */
+Schema schema_default(void)
+{
+	SchemaKinds kind;
+	int i;
+
+	Schema ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("schema_default: calloc failed.\n");
+		return NULL;
+	}
+
+	for (kind = 0; kind < SCHEMA_KIND_NUMBER; ++kind) {
+		for (i = 0; NULL != default_names[kind][i]; ++i) {
+			if (schema_add(ret, kind, default_names[kind][i], default_labels[kind][i], 1)) {
+				schema_destroy(ret);
+				return NULL;
+			}
+		}
+	}
+
+	if (schema_build(ret)) {
+		schema_destroy(ret);
+		return NULL;
+	}
+	return ret;
+}
+
+/**
+ * Returns the schema described by the file at [path], NULL if the
+ * file can't be read or isn't a valid descriptor.
+ */
+Schema schema_load(const char * const path)
+{
+	char line[_SCHEMA_LINE_LENGTH];
+	int number = 0, failed = 0;
+	FILE *f;
+
+	if (NULL == path) {
+		WARNING("schema_load: NULL pointer argument.\n");
+		return NULL;
+	}
+	if (NULL == (f = fopen(path, "r"))) {
+		WARNING("schema_load: unable to open \"%s\".\n", path);
+		return NULL;
+	}
+
+	Schema ret = calloc(1, sizeof(*ret));
+	if (NULL == ret) {
+		DEBUG_PRINT("schema_load: calloc failed.\n");
+		fclose(f);
+		return NULL;
+	}
+
+	while (!failed && (NULL != fgets(line, sizeof(line), f))) {
+		++number;
+		if ((NULL == strchr(line, '\n')) && !feof(f)) {
+			WARNING("schema_load: %s:%d: line too long.\n", path, number);
+			failed = 1;
+		}
+		else {
+			failed = schema_parseLine(ret, line, path, number);
+		}
+	}
+	if (failed || ferror(f)) {
+		fclose(f);
+		schema_destroy(ret);
+		return NULL;
+	}
+	fclose(f);
+
+	if (schema_build(ret)) {
+		WARNING("schema_load: %s: invalid schema.\n", path);
+		schema_destroy(ret);
+		return NULL;
+	}
+
+	DEBUG_PRINT("schema_load: %s: %d measures, %d commands.\n", path,
+		ret->entries[SCHEMA_MEAS].count, ret->entries[SCHEMA_CMDS].count);
+	return ret;
+}
+
+void schema_destroy(Schema s)
+{
+	SchemaKinds kind;
+	int i;
+
+	if (NULL == s) {
+		return;
+	}
+
+	for (kind = 0; kind < SCHEMA_KIND_NUMBER; ++kind) {
+		for (i = 0; i < s->entries[kind].count; ++i) {
+			free(s->entries[kind].names[i]);
+			free(s->entries[kind].labels[i]);
+		}
+		free(s->entries[kind].names);
+		free(s->entries[kind].labels);
+		free(s->entries[kind].every);
+		names_destroy(s->entries[kind].table);
+	}
+	free(s);
+}
+
+/**
+ * Returns the number of entries of [kind] in [s].
+ */
+int schema_count(const Schema s, const SchemaKinds kind)
+{
+	if (schema_check(s, kind, "schema_count")) {
+		return 0;
+	}
+	return s->entries[kind].count;
+}
+
+/**
+ * Returns the index of the [kind] entry called [name], -1 if
+ * there is none.
+ */
+int schema_find(const Schema s, const SchemaKinds kind, const char * const name)
+{
+	if (schema_check(s, kind, "schema_find")) {
+		return -1;
+	}
+	return names_find(s->entries[kind].table, name);
+}
+
+const char *schema_name(const Schema s, const SchemaKinds kind, const int index)
+{
+	if (schema_check(s, kind, "schema_name") || (0 > index) || (s->entries[kind].count <= index)) {
+		return NULL;
+	}
+	return s->entries[kind].names[index];
+}
+
+const char *schema_label(const Schema s, const SchemaKinds kind, const int index)
+{
+	if (schema_check(s, kind, "schema_label") || (0 > index) || (s->entries[kind].count <= index)) {
+		return NULL;
+	}
+	return s->entries[kind].labels[index];
+}
+
+/**
+ * Returns the size of a [kind] wire frame: the control and one
+ * double per entry.
+ */
+size_t schema_frameSize(const Schema s, const SchemaKinds kind)
+{
+	return sizeof(int32_t) + schema_count(s, kind) * sizeof(double);
+}
+
+/**
+ * Returns the reporting rate of the measure [index] of [s], in
+ * intervals.
+ */
+int schema_every(const Schema s, const int index)
+{
+	if (schema_check(s, SCHEMA_MEAS, "schema_every") || (0 > index) || (s->entries[SCHEMA_MEAS].count <= index)) {
+		return 1;
+	}
+	return s->entries[SCHEMA_MEAS].every[index];
+}
+
+/**
+ * Returns non-zero if some measure of [s] isn't due every interval.
+ */
+int schema_isMultirate(const Schema s)
+{
+	return (NULL != s) && s->multirate;
+}
+
+/**
+ * Returns the number of measures of [s] due in the interval of
+ * [control].
+ */
+int schema_dueCount(const Schema s, const int32_t control)
+{
+	int i, ret = 0;
+
+	if (!schema_isMultirate(s)) {
+		return schema_count(s, SCHEMA_MEAS);
+	}
+	for (i = 0; i < s->entries[SCHEMA_MEAS].count; ++i) {
+		ret += schema_isDue(s, i, control);
+	}
+	return ret;
+}
+
+/************************************************************
+* Local functions definition
+************************************************************/
+
+/**
+ * Appends the entry [name] to the [kind] entries of [s], labelled
+ * [label] and due [every] intervals.
+ */
+static int schema_add(Schema s, const SchemaKinds kind, const char * const name, const char * const label, const int every)
+{
+	struct schema_entries *e = &s->entries[kind];
+	char **names, **labels;
+	int *everys;
+
+	if (SCHEMA_MAX_ENTRIES <= e->count) {
+		WARNING("schema_add: more than %d %s entries.\n", SCHEMA_MAX_ENTRIES, kind_names[kind]);
+		return -1;
+	}
+
+	names = realloc(e->names, (e->count + 1) * sizeof(char *));
+	if (NULL != names) {
+		e->names = names;
+	}
+	labels = realloc(e->labels, (e->count + 1) * sizeof(char *));
+	if (NULL != labels) {
+		e->labels = labels;
+	}
+	everys = realloc(e->every, (e->count + 1) * sizeof(int));
+	if (NULL != everys) {
+		e->every = everys;
+	}
+	if ((NULL == names) || (NULL == labels) || (NULL == everys)) {
+		DEBUG_PRINT("schema_add: realloc failed.\n");
+		return -1;
+	}
+
+	e->every[e->count] = every;
+	s->multirate |= (1 != every);
+
+	e->names[e->count] = strdup(name);
+	e->labels[e->count] = strdup(label);
+	++e->count;
+	if ((NULL == e->names[e->count - 1]) || (NULL == e->labels[e->count - 1])) {
+		DEBUG_PRINT("schema_add: strdup failed.\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Builds the name tables of [s], once all its entries are added.
+ * Fails if a kind has no entry, or twice the same name.
+ */
+static int schema_build(Schema s)
+{
+	SchemaKinds kind;
+	struct schema_entries *e;
+
+	for (kind = 0; kind < SCHEMA_KIND_NUMBER; ++kind) {
+		e = &s->entries[kind];
+		if (0 == e->count) {
+			WARNING("schema_build: no %s entry.\n", kind_names[kind]);
+			return -1;
+		}
+		e->table = names_init((const char * const *) e->names, e->count);
+		if (NULL == e->table) {
+			WARNING("schema_build: duplicate %s names.\n", kind_names[kind]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Adds the entry on [line] of descriptor [path] to [s]. Blank
+ * lines and comments are skipped.
+ */
+static int schema_parseLine(Schema s, char *line, const char * const path, const int number)
+{
+	char *kind_word, *name, *label, *end, *save;
+	SchemaKinds kind;
+	long every = 1;
+
+	if (NULL != (end = strchr(line, '#'))) {
+		*end = '\0';
+	}
+	for (end = line + strlen(line); (end > line) && isspace((unsigned char) end[-1]); --end);
+	*end = '\0';
+
+	kind_word = strtok_r(line, " \t", &save);
+	if (NULL == kind_word) {
+		return 0;
+	}
+	name = strtok_r(NULL, " \t", &save);
+	label = strtok_r(NULL, "", &save);
+
+	for (kind = 0; kind < SCHEMA_KIND_NUMBER; ++kind) {
+		if (0 == strcmp(kind_word, kind_names[kind])) {
+			break;
+		}
+	}
+	if (SCHEMA_KIND_NUMBER <= kind) {
+		WARNING("schema_load: %s:%d: unknown kind \"%s\".\n", path, number, kind_word);
+		return -1;
+	}
+	if ((NULL == name) || (SCHEMA_NAME_LENGTH <= strlen(name))) {
+		WARNING("schema_load: %s:%d: missing or too long name.\n", path, number);
+		return -1;
+	}
+
+	if (NULL != label) {
+		while (isspace((unsigned char) *label)) {
+			++label;
+		}
+	}
+	if ((NULL != label) && (0 == strncmp(label, "every", 5)) && isspace((unsigned char) label[5])) {
+		every = strtol(label + 5, &end, 10);
+		if ((end == label + 5) || (1 > every) || (SCHEMA_MAX_EVERY < every) ||
+			(('\0' != *end) && !isspace((unsigned char) *end))) {
+			WARNING("schema_load: %s:%d: invalid rate.\n", path, number);
+			return -1;
+		}
+		if (SCHEMA_MEAS != kind) {
+			WARNING("schema_load: %s:%d: commands come every interval.\n", path, number);
+			return -1;
+		}
+		for (label = end; isspace((unsigned char) *label); ++label);
+	}
+	if ((NULL == label) || ('\0' == *label)) {
+		label = name;
+	}
+
+	return schema_add(s, kind, name, label, (int) every);
+}
+
+static int schema_check(const Schema s, const SchemaKinds kind, const char * const fname)
+{
+	if (NULL == s) {
+		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
+		return -1;
+	}
+	if (SCHEMA_KIND_NUMBER <= kind) {
+		DEBUG_PRINT("%s: kind %d is not valid.\n", fname, kind);
+		return -1;
+	}
+	return 0;
+}
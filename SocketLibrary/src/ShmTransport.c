@@ -0,0 +1,567 @@
+#include <ShmTransport.h>
+
+#include <Debug.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _SHM_SUCCESS	0
+#define _SHM_INVALID	-1
+#define _SHM_FAILED		-2
+#define _SHM_CLOSED		-3
+
+#define _SHM_MAGIC		0x48534d32	/* "HSM2" */
+#define _SHM_RING_SIZE	(1U << 16)	/* must be a power of 2 */
+#define _SHM_RING_MASK	(_SHM_RING_SIZE - 1)
+#define _SHM_SPIN		2000		/* checks before sleeping on a futex */
+#define _SHM_LINE		64
+/* Longest sleep before checking that the peer is still alive,
+ * in milliseconds. */
+#define _SHM_LIVENESS_MILLIS	100
+
+/************************************************************
+* Local structs
+************************************************************/
+
+/* Single-producer/single-consumer byte ring. Indexes are
+ * free running, each lives on its own cache line. */
+struct _shm_ring {
+	uint32_t head;		/* written by producer */
+	char pad0[_SHM_LINE - sizeof(uint32_t)];
+	uint32_t tail;		/* written by consumer */
+	char pad1[_SHM_LINE - sizeof(uint32_t)];
+	uint32_t rx_waiting;	/* consumer sleeps on head */
+	uint32_t tx_waiting;	/* producer sleeps on tail */
+	char pad2[_SHM_LINE - 2 * sizeof(uint32_t)];
+	char data[_SHM_RING_SIZE];
+};
+
+/* Layout of the mapped memory. */
+struct _shm_layout {
+	uint32_t magic;
+	uint32_t attached[SHM_ROLE_NUMBER];
+	/* Process of each side, to tell a crashed peer. */
+	uint32_t pid[SHM_ROLE_NUMBER];
+	char pad[_SHM_LINE - (1 + 2 * SHM_ROLE_NUMBER) * sizeof(uint32_t)];
+	/* [channel][destination role] */
+	struct _shm_ring rings[SOCKET_NUMBER][SHM_ROLE_NUMBER];
+};
+
+struct _shm_channel {
+	struct _shm_ring *rx;
+	struct _shm_ring *tx;
+	uint32_t *peer;
+	uint32_t *peer_pid;
+};
+
+struct _shm_segment {
+	struct _shm_layout *layout;
+	ShmRoles role;
+	char *path;
+	struct _shm_channel channels[SOCKET_NUMBER];
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static ShmSegment SHM_open(const char * const path, const ShmRoles role);
+static int SHM_check(ShmSegment s, const char * const fname);
+static int SHM_waitChange(uint32_t *word, const uint32_t old, uint32_t *waiting, const long long deadline);
+static void SHM_wake(uint32_t *word, uint32_t *waiting);
+static int SHM_peerAlive(ShmChannel c);
+static long long SHM_slice(const long long deadline);
+static long long SHM_deadline(const int timeout);
+
+#ifdef __linux__
+
+/************************************************************
+* Segment functions
+************************************************************/
+
+/**
+ * Creates (or truncates) the segment at [path] and attaches to
+ * it as server. Returns NULL on failure.
+ */
+ShmSegment SHM_create(const char * const path)
+{
+	return SHM_open(path, SHM_ROLE_SERVER);
+}
+
+/**
+ * Attaches to the segment created by the server at [path] as
+ * controller. Returns NULL on failure.
+ */
+ShmSegment SHM_attach(const char * const path)
+{
+	return SHM_open(path, SHM_ROLE_CONTROLLER);
+}
+
+static ShmSegment SHM_open(const char * const path, const ShmRoles role)
+{
+	if (NULL == path) {
+		DEBUG_PRINT("SHM_open: NULL pointer argument.\n");
+		return NULL;
+	}
+
+	int fd, flags = O_RDWR;
+	struct _shm_segment *ret;
+	struct _shm_layout *layout;
+	int channel;
+	char tmp_path[PATH_MAX];
+
+	/* The server prepares the segment under a temporary name, so
+	 * that a controller never maps a partially created file. */
+	if (SHM_ROLE_SERVER == role) {
+		flags |= O_CREAT | O_TRUNC;
+		if (sizeof(tmp_path) <= snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path)) {
+			DEBUG_PRINT("SHM_open: path \"%s\" is too long.\n", path);
+			return NULL;
+		}
+	}
+	else {
+		snprintf(tmp_path, sizeof(tmp_path), "%s", path);
+	}
+	if (0 > (fd = open(tmp_path, flags, 0600))) {
+		DEBUG_PRINT("SHM_open: unable to open \"%s\".\n", tmp_path);
+		return NULL;
+	}
+	if ((SHM_ROLE_SERVER == role) && (0 > ftruncate(fd, sizeof(*layout)))) {
+		DEBUG_PRINT("SHM_open: unable to size \"%s\".\n", tmp_path);
+		close(fd);
+		return NULL;
+	}
+	layout = mmap(NULL, sizeof(*layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == layout) {
+		DEBUG_PRINT("SHM_open: unable to map \"%s\".\n", tmp_path);
+		return NULL;
+	}
+
+	if (SHM_ROLE_SERVER == role) {
+		__atomic_store_n(&layout->magic, _SHM_MAGIC, __ATOMIC_SEQ_CST);
+		if (0 > rename(tmp_path, path)) {
+			DEBUG_PRINT("SHM_open: unable to publish \"%s\".\n", path);
+			unlink(tmp_path);
+			munmap(layout, sizeof(*layout));
+			return NULL;
+		}
+	}
+	else if (_SHM_MAGIC != __atomic_load_n(&layout->magic, __ATOMIC_SEQ_CST)) {
+		DEBUG_PRINT("SHM_open: \"%s\" is not a server segment.\n", path);
+		munmap(layout, sizeof(*layout));
+		return NULL;
+	}
+
+	ret = calloc(1, sizeof(*ret));
+	if ((NULL == ret) || (NULL == (ret->path = strdup(path)))) {
+		DEBUG_PRINT("SHM_open: calloc failed.\n");
+		free(ret);
+		munmap(layout, sizeof(*layout));
+		return NULL;
+	}
+	ret->layout = layout;
+	ret->role = role;
+
+	for (channel = 0; channel < SOCKET_NUMBER; ++channel) {
+		ret->channels[channel].rx = &layout->rings[channel][role];
+		ret->channels[channel].tx = &layout->rings[channel][1 - role];
+		ret->channels[channel].peer = &layout->attached[1 - role];
+		ret->channels[channel].peer_pid = &layout->pid[1 - role];
+	}
+
+	__atomic_store_n(&layout->pid[role], (uint32_t) getpid(), __ATOMIC_SEQ_CST);
+	__atomic_store_n(&layout->attached[role], 1, __ATOMIC_SEQ_CST);
+	SHM_wake(&layout->attached[role], NULL);
+
+	return ret;
+}
+
+/**
+ * Marks this side as detached, waking up the peer, and unmaps
+ * the segment. The server also removes the backing file.
+ */
+int SHM_detach(ShmSegment s)
+{
+	if (_SHM_SUCCESS != SHM_check(s, "SHM_detach")) {
+		return _SHM_INVALID;
+	}
+
+	int channel;
+
+	__atomic_store_n(&s->layout->attached[s->role], 0, __ATOMIC_SEQ_CST);
+	SHM_wake(&s->layout->attached[s->role], NULL);
+	for (channel = 0; channel < SOCKET_NUMBER; ++channel) {
+		SHM_wake(&s->channels[channel].tx->head, NULL);
+	}
+
+	if (SHM_ROLE_SERVER == s->role) {
+		unlink(s->path);
+	}
+	munmap(s->layout, sizeof(*s->layout));
+	free(s->path);
+	free(s);
+
+	return _SHM_SUCCESS;
+}
+
+/**
+ * Server side: forgets the controller that detached or died, and
+ * empties the rings, so that a new controller can attach.
+ */
+int SHM_reset(ShmSegment s)
+{
+	if (_SHM_SUCCESS != SHM_check(s, "SHM_reset")) {
+		return _SHM_INVALID;
+	}
+	if (SHM_ROLE_SERVER != s->role) {
+		DEBUG_PRINT("SHM_reset: only the server resets the segment.\n");
+		return _SHM_INVALID;
+	}
+
+	int channel, role;
+	struct _shm_ring *r;
+
+	__atomic_store_n(&s->layout->attached[SHM_ROLE_CONTROLLER], 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&s->layout->pid[SHM_ROLE_CONTROLLER], 0, __ATOMIC_SEQ_CST);
+	for (channel = 0; channel < SOCKET_NUMBER; ++channel) {
+		for (role = 0; role < SHM_ROLE_NUMBER; ++role) {
+			r = &s->layout->rings[channel][role];
+			__atomic_store_n(&r->head, 0, __ATOMIC_SEQ_CST);
+			__atomic_store_n(&r->tail, 0, __ATOMIC_SEQ_CST);
+		}
+	}
+	return _SHM_SUCCESS;
+}
+
+/**
+ * Waits up to [timeout] milliseconds (forever if negative) for
+ * the peer to attach. Returns 0 once attached, non-zero otherwise.
+ */
+int SHM_waitPeer(ShmSegment s, const int timeout)
+{
+	if (_SHM_SUCCESS != SHM_check(s, "SHM_waitPeer")) {
+		return _SHM_INVALID;
+	}
+
+	uint32_t *peer = &s->layout->attached[1 - s->role];
+	long long deadline = SHM_deadline(timeout);
+
+	while (0 == __atomic_load_n(peer, __ATOMIC_SEQ_CST)) {
+		if (SHM_waitChange(peer, 0, NULL, deadline)) {
+			return _SHM_FAILED;
+		}
+	}
+	return _SHM_SUCCESS;
+}
+
+ShmChannel SHM_getChannel(ShmSegment s, const int channel)
+{
+	if (_SHM_SUCCESS != SHM_check(s, "SHM_getChannel")) {
+		return NULL;
+	}
+	if ((0 > channel) || (SOCKET_NUMBER <= channel)) {
+		DEBUG_PRINT("SHM_getChannel: invalid channel %d.\n", channel);
+		return NULL;
+	}
+	return &s->channels[channel];
+}
+
+/************************************************************
+* Channel functions
+************************************************************/
+
+/**
+ * Returns 0 if no data can be read from [c] within [timeout]
+ * milliseconds (forever if negative), non-zero otherwise. A
+ * detached or dead peer counts as readable, so that the
+ * following read detects it.
+ */
+int SHM_wait(ShmChannel c, const int timeout)
+{
+	if (NULL == c) {
+		DEBUG_PRINT("SHM_wait: NULL pointer argument.\n");
+		return 0;
+	}
+
+	long long deadline = SHM_deadline(timeout);
+	uint32_t head;
+
+	for (;;) {
+		head = __atomic_load_n(&c->rx->head, __ATOMIC_ACQUIRE);
+		if ((head != __atomic_load_n(&c->rx->tail, __ATOMIC_RELAXED)) || !SHM_peerAlive(c)) {
+			return 1;
+		}
+		if (SHM_waitChange(&c->rx->head, head, &c->rx->rx_waiting, SHM_slice(deadline)) &&
+			(0 <= deadline) && (SHM_deadline(0) >= deadline)) {
+			return 0;
+		}
+	}
+}
+
+/**
+ * Reads exactly [count] bytes from [c], waiting as needed.
+ * Returns 0 on success, non-zero if the peer detached or died.
+ */
+int SHM_recv(ShmChannel c, char *buf, const size_t count)
+{
+	if ((NULL == c) || (NULL == buf)) {
+		DEBUG_PRINT("SHM_recv: NULL pointer argument.\n");
+		return _SHM_INVALID;
+	}
+
+	struct _shm_ring *r = c->rx;
+	uint32_t head, tail, chunk;
+	size_t n = 0;
+
+	while (n < count) {
+		tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			if (!SHM_peerAlive(c)) {
+				return _SHM_CLOSED;
+			}
+			SHM_waitChange(&r->head, head, &r->rx_waiting, SHM_slice(-1));
+			continue;
+		}
+		chunk = head - tail;
+		if (chunk > count - n) {
+			chunk = count - n;
+		}
+		if (chunk > _SHM_RING_SIZE - (tail & _SHM_RING_MASK)) {
+			chunk = _SHM_RING_SIZE - (tail & _SHM_RING_MASK);
+		}
+		memcpy(buf + n, r->data + (tail & _SHM_RING_MASK), chunk);
+		__atomic_store_n(&r->tail, tail + chunk, __ATOMIC_SEQ_CST);
+		SHM_wake(&r->tail, &r->tx_waiting);
+		n += chunk;
+	}
+
+	return _SHM_SUCCESS;
+}
+
+/**
+ * Writes exactly [count] bytes to [c], waiting for space as
+ * needed. Returns 0 on success, non-zero if the peer detached or
+ * died.
+ */
+int SHM_send(ShmChannel c, const char * const buf, const size_t count)
+{
+	if ((NULL == c) || (NULL == buf)) {
+		DEBUG_PRINT("SHM_send: NULL pointer argument.\n");
+		return _SHM_INVALID;
+	}
+
+	struct _shm_ring *r = c->tx;
+	uint32_t head, tail, chunk;
+	size_t n = 0;
+
+	while (n < count) {
+		if (0 == __atomic_load_n(c->peer, __ATOMIC_ACQUIRE)) {
+			return _SHM_CLOSED;
+		}
+		head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+		tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		if (_SHM_RING_SIZE == head - tail) {
+			/* Only a full ring costs the liveness syscall. */
+			if (!SHM_peerAlive(c)) {
+				return _SHM_CLOSED;
+			}
+			SHM_waitChange(&r->tail, tail, &r->tx_waiting, SHM_slice(-1));
+			continue;
+		}
+		chunk = _SHM_RING_SIZE - (head - tail);
+		if (chunk > count - n) {
+			chunk = count - n;
+		}
+		if (chunk > _SHM_RING_SIZE - (head & _SHM_RING_MASK)) {
+			chunk = _SHM_RING_SIZE - (head & _SHM_RING_MASK);
+		}
+		memcpy(r->data + (head & _SHM_RING_MASK), buf + n, chunk);
+		__atomic_store_n(&r->head, head + chunk, __ATOMIC_SEQ_CST);
+		SHM_wake(&r->head, &r->rx_waiting);
+		n += chunk;
+	}
+
+	return _SHM_SUCCESS;
+}
+
+/************************************************************
+* Futex helpers
+************************************************************/
+
+/**
+ * Waits until [word] differs from [old] or [deadline] (monotonic
+ * milliseconds, negative for none) expires. Spins first, then
+ * sleeps on the futex advertising itself through [waiting].
+ * Returns 0 if [word] may have changed, non-zero on timeout.
+ */
+static int SHM_waitChange(uint32_t *word, const uint32_t old, uint32_t *waiting, const long long deadline)
+{
+	struct timespec ts, *tsp = NULL;
+	long long left;
+	int i;
+
+	for (i = 0; i < _SHM_SPIN; ++i) {
+		if (old != __atomic_load_n(word, __ATOMIC_ACQUIRE)) {
+			return _SHM_SUCCESS;
+		}
+	}
+
+	if (0 <= deadline) {
+		left = deadline - SHM_deadline(0);
+		if (0 >= left) {
+			return _SHM_FAILED;
+		}
+		ts.tv_sec = left / 1000;
+		ts.tv_nsec = (left % 1000) * 1000000L;
+		tsp = &ts;
+	}
+
+	if (NULL != waiting) {
+		__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+	}
+	if (old == __atomic_load_n(word, __ATOMIC_SEQ_CST)) {
+		syscall(SYS_futex, word, FUTEX_WAIT, old, tsp, NULL, 0);
+	}
+	if (NULL != waiting) {
+		__atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+	}
+
+	return _SHM_SUCCESS;
+}
+
+/**
+ * Wakes up whoever sleeps on [word]. If [waiting] is given, the
+ * syscall is skipped when nobody advertised itself as sleeping.
+ */
+static void SHM_wake(uint32_t *word, uint32_t *waiting)
+{
+	if ((NULL != waiting) && (0 == __atomic_load_n(waiting, __ATOMIC_SEQ_CST))) {
+		return;
+	}
+	syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * Returns non-zero if the peer of [c] is attached and its process
+ * still exists. A peer that crashed never detached, so its
+ * process is checked as well.
+ */
+static int SHM_peerAlive(ShmChannel c)
+{
+	pid_t pid;
+
+	if (0 == __atomic_load_n(c->peer, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	pid = (pid_t) __atomic_load_n(c->peer_pid, __ATOMIC_ACQUIRE);
+	return (0 == pid) || (0 == kill(pid, 0)) || (ESRCH != errno);
+}
+
+/**
+ * Returns [deadline], brought forward so that a wait on it lasts
+ * at most _SHM_LIVENESS_MILLIS: long waits wake up to check the
+ * peer.
+ */
+static long long SHM_slice(const long long deadline)
+{
+	long long slice = SHM_deadline(_SHM_LIVENESS_MILLIS);
+
+	return ((0 > deadline) || (slice < deadline)) ? slice : deadline;
+}
+
+/**
+ * Returns the monotonic time in milliseconds [timeout] from now,
+ * or -1 if [timeout] is negative.
+ */
+static long long SHM_deadline(const int timeout)
+{
+	struct timespec now;
+
+	if (0 > timeout) {
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000LL + timeout;
+}
+
+#else /* __linux__ */
+
+ShmSegment SHM_create(const char * const path)
+{
+	DEBUG_PRINT("SHM_create: futexes are not available on this platform.\n");
+	return NULL;
+}
+
+ShmSegment SHM_attach(const char * const path)
+{
+	DEBUG_PRINT("SHM_attach: futexes are not available on this platform.\n");
+	return NULL;
+}
+
+int SHM_detach(ShmSegment s)
+{
+	return _SHM_INVALID;
+}
+
+int SHM_reset(ShmSegment s)
+{
+	return _SHM_INVALID;
+}
+
+int SHM_waitPeer(ShmSegment s, const int timeout)
+{
+	return _SHM_INVALID;
+}
+
+ShmChannel SHM_getChannel(ShmSegment s, const int channel)
+{
+	return NULL;
+}
+
+int SHM_wait(ShmChannel c, const int timeout)
+{
+	return 0;
+}
+
+int SHM_recv(ShmChannel c, char *buf, const size_t count)
+{
+	return _SHM_INVALID;
+}
+
+int SHM_send(ShmChannel c, const char * const buf, const size_t count)
+{
+	return _SHM_INVALID;
+}
+
+#endif /* __linux__ */
+
+static int SHM_check(ShmSegment s, const char * const fname)
+{
+	if ((NULL == s) || (NULL == s->layout)) {
+		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
+		return _SHM_INVALID;
+	}
+	return _SHM_SUCCESS;
+}
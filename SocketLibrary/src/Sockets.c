@@ -9,6 +9,15 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static int socket_fill(struct socket_singleton *socket, const size_t wanted);
+static void socket_closed(struct socket_singleton *socket, const char * const fname);
 
 /************************************************************
 * Function definition
@@ -52,6 +61,40 @@ int socketBuilder(const unsigned short port, const unsigned int max_con)
 	return result;
 }
 
+/**
+ * Returns the port [fd] is bound to, e.g. the one picked by the
+ * system when built on port 0. Returns -1 on failure.
+ */
+int socketPort(const int fd)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t len = sizeof(addr);
+
+	if(0 > getsockname(fd, (struct sockaddr*) &addr, &len)) {
+		return -1;
+	}
+	return ntohs(addr.sin_port);
+}
+
+/**
+ * Checks that the inherited [fd] is a listening socket, and keeps
+ * it from leaking to child processes.
+ * Returns [fd] on success, negative on failure.
+ */
+int socketAdopt(const int fd)
+{
+	int listening = 0;
+	socklen_t len = sizeof(listening);
+
+	if((0 > getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len)) || (!listening)) {
+		return -1;
+	}
+	if(0 > fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+		return -1;
+	}
+	return fd;
+}
+
 /**
  * Builds a pollfd with [fds_left] file descriptors, taken from the
  * [sockets] not already started. Checks for read events.
@@ -74,26 +117,33 @@ void buildPoll(struct pollfd *fds, const int fds_left, struct socket_singleton *
 
 /**
  * Accepts a connection from all ready file descriptors, and returns
- * the number of file descriptors who must still be started.
+ * the number of file descriptors who must still be started. The
+ * listening sockets stay open, to accept a controller again if
+ * this one leaves.
  */
 int acceptConnections(const struct pollfd *fds, int fds_left, struct socket_singleton *sockets)
 {
-	int i, j, m, found;
+	int i, j, m;
 
 	m = fds_left;
 
 	for(i = 0; i < m; ++i) {
 		if(fds[i].revents & POLLIN) {
-			found = 0;
-			for(j = 0; (j < SOCKET_NUMBER) && (0 == found); ++j) {
+			for(j = 0; j < SOCKET_NUMBER; ++j) {
 				if(sockets[j].listen_fd == fds[i].fd) {
-					found = 1;
-					sockets[j].accept_fd = accept(sockets[j].listen_fd, NULL, NULL);
-					sockets[j].started = 1;
-					close(sockets[j].listen_fd);
-					DEBUG_PRINT("Started socket %d.\n", j);
+					break;
 				}
 			}
+			if(SOCKET_NUMBER == j) {
+				continue;
+			}
+			sockets[j].accept_fd = accept(sockets[j].listen_fd, NULL, NULL);
+			if(0 > sockets[j].accept_fd) {
+				DEBUG_PRINT("acceptConnections: accept failed on socket %d.\n", j);
+				continue;
+			}
+			sockets[j].started = 1;
+			DEBUG_PRINT("Started socket %d.\n", j);
 			--fds_left;
 		}
 	}
@@ -104,50 +154,280 @@ int acceptConnections(const struct pollfd *fds, int fds_left, struct socket_sing
 * Socket read and write functions
 ************************************************************/
 
+/**
+ * Reads exactly [count] bytes. Data is served from the read
+ * buffer, which is refilled with a single recv of all the bytes
+ * available. Returns early if the peer closes the connection.
+ */
 void recv_complete(struct socket_singleton *socket, char *buf, const size_t count)
 {
 	if(0 >= count) {
 		ERROR("recv_complete: can't read %zd bytes\n", count);
 	}
 
-	size_t n = 0;
-	ssize_t r;
+	if(NULL != socket->shm) {
+		if(SHM_recv(socket->shm, buf, count)) {
+			WARNING("recv_complete: shared memory peer detached or died\n");
+			socket->started = 0;
+		}
+		return;
+	}
 
-	while(n < count) {
+	size_t n = 0, chunk;
 
-		r = recv(socket->accept_fd, buf+n, count - n, 0);
-		if(0 > r) {
-			ERROR("recv_complete: recv failed\n");
+	while(n < count) {
+		if((socket->read_pos == socket->read_len) && socket_fill(socket, count - n)) {
+			return;
 		}
-		else if(0 == r) {
-			WARNING("recv_complete: socket %d closed\n", socket->accept_fd);
-			socket->accept_fd = 0;
-			socket->started = 0;
+		chunk = socket->read_len - socket->read_pos;
+		if(chunk > count - n) {
+			chunk = count - n;
 		}
-		n += r;
+		memcpy(buf + n, socket->read_buf + socket->read_pos, chunk);
+		socket->read_pos += chunk;
+		n += chunk;
 	}
-
 }
 
+/**
+ * Sends exactly [count] bytes, along with anything already
+ * gathered by socket_write, in a single send.
+ */
 void send_complete(struct socket_singleton *socket, const char * const buf, size_t const count)
 {
 	if(0 >= count) {
 		ERROR("send_complete: can't send %zd bytes\n", count);
 	}
 
-	size_t n = 0, s;
+	if(NULL != socket->shm) {
+		if(SHM_send(socket->shm, buf, count)) {
+			WARNING("send_complete: shared memory peer detached or died\n");
+			socket->started = 0;
+		}
+		return;
+	}
+
+	struct iovec iov[2];
+	int iovcnt = 0;
 
-	while(n < count) {
-		s = send(socket->accept_fd, buf+n, count - n, 0);
-		if(0 >= s) {
-			ERROR("send_complete: send failed\n");
+	if(0 < socket->write_len) {
+		iov[iovcnt].iov_base = socket->write_buf;
+		iov[iovcnt].iov_len = socket->write_len;
+		++iovcnt;
+	}
+	iov[iovcnt].iov_base = (char *) buf;
+	iov[iovcnt].iov_len = count;
+	++iovcnt;
+
+	send_frame(socket, iov, iovcnt);
+	socket->write_len = 0;
+}
+
+/**
+ * Appends [count] bytes to the write buffer, flushing it first
+ * if they don't fit. Nothing is sent until socket_flush.
+ */
+void socket_write(struct socket_singleton *socket, const char * const buf, const size_t count)
+{
+	if(NULL != socket->shm) {
+		send_complete(socket, buf, count);
+		return;
+	}
+
+	if(NULL == socket->write_buf) {
+		if(NULL == (socket->write_buf = malloc(SOCKET_BUFFER_SIZE))) {
+			ERROR("socket_write: malloc failed\n");
 		}
-		else if(0 == s) {
-			WARNING("send_complete: socket %d closed\n", socket->accept_fd);
-			socket->accept_fd = 0;
-			socket->started = 0;
+	}
+	if(SOCKET_BUFFER_SIZE - socket->write_len < count) {
+		send_complete(socket, buf, count);
+		return;
+	}
+	memcpy(socket->write_buf + socket->write_len, buf, count);
+	socket->write_len += count;
+}
+
+/**
+ * Sends everything gathered by socket_write.
+ */
+void socket_flush(struct socket_singleton *socket)
+{
+	if(0 == socket->write_len) {
+		return;
+	}
+
+	struct iovec iov = { socket->write_buf, socket->write_len };
+
+	send_frame(socket, &iov, 1);
+	socket->write_len = 0;
+}
+
+/**
+ * Sends the [iovcnt] buffers of [iov] with as few sendmsg calls
+ * as possible (one, unless the kernel takes a partial write).
+ * [iov] is consumed.
+ */
+void send_frame(struct socket_singleton *socket, struct iovec *iov, int iovcnt)
+{
+	struct msghdr msg = {0};
+	ssize_t s;
+
+	while(0 < iovcnt) {
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		s = sendmsg(socket->accept_fd, &msg, MSG_NOSIGNAL);
+		++socket->stats.send_calls;
+		if(0 > s) {
+			if(EINTR == errno) {
+				continue;
+			}
+			if((EPIPE == errno) || (ECONNRESET == errno)) {
+				socket_closed(socket, "send_frame");
+				return;
+			}
+			ERROR("send_frame: send failed\n");
 		}
-		n += s;
+		socket->stats.bytes_sent += s;
+
+		/* Skip what was sent. */
+		while((0 < iovcnt) && (iov->iov_len <= (size_t) s)) {
+			s -= iov->iov_len;
+			++iov;
+			--iovcnt;
+		}
+		if(0 < iovcnt) {
+			++socket->stats.partial_sends;
+			iov->iov_base = (char *) iov->iov_base + s;
+			iov->iov_len -= s;
+		}
+	}
+}
+
+/**
+ * Returns the number of bytes already read from the kernel and
+ * not yet consumed: if non-zero, a read won't block.
+ */
+size_t socket_buffered(const struct socket_singleton *socket)
+{
+	return socket->read_len - socket->read_pos;
+}
+
+/**
+ * Waits up to [timeout] milliseconds for [socket] to become
+ * readable. Returns non-zero if it is, or if the peer hung up.
+ */
+int socket_wait(const struct socket_singleton *socket, const int timeout)
+{
+	struct pollfd fd_wait = {0};
+
+	if(0 < socket_buffered(socket)) {
+		return 1;
+	}
+
+	fd_wait.fd = socket->accept_fd;
+	fd_wait.events = POLLIN;
+
+	if(0 >= poll(&fd_wait, 1, timeout)) {
+		return 0;
+	}
+	return 0 != (fd_wait.revents & (POLLIN | POLLHUP | POLLERR));
+}
+
+/**
+ * Closes the connection of [socket], if started, and drops
+ * anything buffered for it. The listening socket is kept.
+ */
+void socket_close(struct socket_singleton *socket)
+{
+	if(socket->started && (NULL == socket->shm)) {
+		close(socket->accept_fd);
 	}
+	socket->accept_fd = -1;
+	socket->started = 0;
+	socket->read_pos = socket->read_len = 0;
+	socket->write_len = 0;
 }
 
+/**
+ * Frees the userspace buffers of [socket].
+ */
+void socket_release(struct socket_singleton *socket)
+{
+	free(socket->write_buf);
+	free(socket->read_buf);
+	socket->write_buf = NULL;
+	socket->read_buf = NULL;
+	socket->write_len = socket->read_pos = socket->read_len = 0;
+}
+
+/**
+ * Returns the read buffer of the empty [socket], to be filled by
+ * an I/O backend with at most SOCKET_BUFFER_SIZE bytes.
+ */
+char *socket_prepareRead(struct socket_singleton *socket)
+{
+	if(NULL == socket->read_buf) {
+		if(NULL == (socket->read_buf = malloc(SOCKET_BUFFER_SIZE))) {
+			ERROR("socket_prepareRead: malloc failed\n");
+		}
+	}
+	return socket->read_buf;
+}
+
+/**
+ * Accounts for a read of [r] bytes into the buffer returned by
+ * socket_prepareRead, [r] being a negative errno on failure.
+ * Returns 0 on success, non-zero if the connection was closed.
+ */
+int socket_commitRead(struct socket_singleton *socket, const ssize_t r, const size_t wanted)
+{
+	if((0 == r) || (-ECONNRESET == r)) {
+		socket_closed(socket, "recv_complete");
+		return 1;
+	}
+	if(0 > r) {
+		ERROR("recv_complete: recv failed\n");
+	}
+
+	if((size_t) r < wanted) {
+		++socket->stats.partial_reads;
+	}
+	socket->stats.bytes_received += r;
+	socket->read_pos = 0;
+	socket->read_len = r;
+
+	return 0;
+}
+
+void socket_printStats(const struct socket_singleton *socket, const char * const name)
+{
+	WARNING("%s: %llu sends (%llu partial) for %llu bytes, %llu recvs (%llu partial) for %llu bytes.\n",
+		name,
+		socket->stats.send_calls, socket->stats.partial_sends, socket->stats.bytes_sent,
+		socket->stats.recv_calls, socket->stats.partial_reads, socket->stats.bytes_received);
+}
+
+/**
+ * Refills the empty read buffer with a single recv. A recv
+ * returning less than the [wanted] bytes is a partial read.
+ * Returns 0 on success, non-zero if the connection was closed.
+ */
+static int socket_fill(struct socket_singleton *socket, const size_t wanted)
+{
+	char *buf = socket_prepareRead(socket);
+	ssize_t r;
+
+	do {
+		r = recv(socket->accept_fd, buf, SOCKET_BUFFER_SIZE, 0);
+		++socket->stats.recv_calls;
+	} while((0 > r) && (EINTR == errno));
+
+	return socket_commitRead(socket, (0 > r) ? -errno : r, wanted);
+}
+
+static void socket_closed(struct socket_singleton *socket, const char * const fname)
+{
+	WARNING("%s: socket %d closed\n", fname, socket->accept_fd);
+	socket_close(socket);
+}
@@ -0,0 +1,136 @@
+#include <Spsc.h>
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _SPSC_SUCCESS	0
+#define _SPSC_INVALID	-1
+#define _SPSC_FULL		-2
+
+#define _SPSC_CACHE_LINE	64
+
+/************************************************************
+* Local structs
+************************************************************/
+
+/* Each index lives on its own cache line, next to the cached
+ * copy of the other index, so that the producer and consumer
+ * only share a line when the cached copy runs out. */
+struct _spsc {
+	size_t mask;
+	void **items;
+
+	char _pad0[_SPSC_CACHE_LINE];
+	/* Written by the producer. */
+	size_t tail;
+	size_t head_cache;
+
+	char _pad1[_SPSC_CACHE_LINE];
+	/* Written by the consumer. */
+	size_t head;
+	size_t tail_cache;
+
+	char _pad2[_SPSC_CACHE_LINE];
+};
+
+/************************************************************
+* Function definition
+************************************************************/
+
+/**
+ * Creates a queue holding up to [capacity] items, rounded up to
+ * a power of two. Returns NULL on failure.
+ */
+SPSC spsc_init(const size_t capacity)
+{
+	struct _spsc *q;
+	size_t size = 1;
+
+	if (0 == capacity) {
+		DEBUG_PRINT("spsc_init: invalid capacity.\n");
+		return NULL;
+	}
+	while (size < capacity) {
+		size <<= 1;
+	}
+
+	if (NULL == (q = calloc(1, sizeof(*q)))) {
+		return NULL;
+	}
+	if (NULL == (q->items = calloc(size, sizeof(*q->items)))) {
+		free(q);
+		return NULL;
+	}
+	q->mask = size - 1;
+
+	return q;
+}
+
+/**
+ * Frees the queue, not the items it still holds.
+ */
+void spsc_destroy(SPSC q)
+{
+	if (NULL == q) {
+		return;
+	}
+	free(q->items);
+	free(q);
+}
+
+/**
+ * Producer side: appends [item]. Returns 0 on success, non-zero
+ * if the queue is full.
+ */
+int spsc_push(SPSC q, void *item)
+{
+	if ((NULL == q) || (NULL == item)) {
+		DEBUG_PRINT("spsc_push: NULL pointer argument.\n");
+		return _SPSC_INVALID;
+	}
+
+	size_t tail = q->tail;
+
+	if (tail - q->head_cache > q->mask) {
+		q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+		if (tail - q->head_cache > q->mask) {
+			return _SPSC_FULL;
+		}
+	}
+	q->items[tail & q->mask] = item;
+	__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return _SPSC_SUCCESS;
+}
+
+/**
+ * Consumer side: removes and returns the oldest item, or NULL
+ * if the queue is empty.
+ */
+void *spsc_pop(SPSC q)
+{
+	if (NULL == q) {
+		DEBUG_PRINT("spsc_pop: NULL pointer argument.\n");
+		return NULL;
+	}
+
+	size_t head = q->head;
+	void *item;
+
+	if (head == q->tail_cache) {
+		q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+		if (head == q->tail_cache) {
+			return NULL;
+		}
+	}
+	item = q->items[head & q->mask];
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+	return item;
+}
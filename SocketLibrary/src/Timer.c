@@ -1,17 +1,41 @@
 #include <Timer.h>
 
 #include <Debug.h>
+#include <Histogram.h>
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <sys/time.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
 #include <poll.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
 
 /************************************************************
 * Defines and macros
 ************************************************************/
 
-#define DEFAULT_TIMEOUT	 3600L  /* in seconds */
+#define DEFAULT_PERIOD	 3600ULL  /* in seconds */
+
+#define NSEC_PER_SEC	1000000000ULL
+#define NSEC_PER_MSEC	1000000ULL
+#define NSEC_PER_USEC	1000ULL
+
+/* Adaptive pace bounds: from one simulated interval per wall
+ * clock interval to the fastest speed an unsigned int holds. */
+#define MAX_INTERVAL(t)	(NSEC_PER_SEC * (t)->period)
+#define MIN_INTERVAL(t)	((MAX_INTERVAL(t) + UINT_MAX - 1) / UINT_MAX)
+
+/* The adaptive spin never drops below this share of its budget,
+ * so that it can grow back. */
+#define SPIN_FLOOR_SHIFT	4
+
+/* Sockets remembered by the busy wait: MEAS and CMDS. */
+#define BUSY_FDS	2
 
 /************************************************************
 * Local structs
@@ -24,17 +48,49 @@ enum _timer_return_values {
 };
 
 struct _timer {
-	struct timeval timestamp;
+	/* Start of the current hour, on CLOCK_MONOTONIC */
+	unsigned long long anchor;
+	unsigned long long interval;
+	/* Simulated seconds per hour */
+	unsigned long long period;
 	unsigned int speed;
 	unsigned int queries_per_int;
+	/* timerfd armed on the step deadlines, -1 if unused */
+	int fd;
+	/* Adaptive mode: share of the first step to keep free, in
+	 * percent, 0 when the speed is fixed */
+	unsigned int slack;
+	/* Smoothed controller round trip time */
+	unsigned long long rtt;
+
+	TimerWaits wait;
+	/* Longest and current spin before blocking */
+	unsigned long long spin_max;
+	unsigned long long spin;
+	/* Sockets SO_BUSY_POLL was set on, -1 if unused, whether it
+	 * worked, and the entry to replace next */
+	int busy_fd[BUSY_FDS];
+	int busy_ok[BUSY_FDS];
+	int busy_next;
+	/* Waits ended while spinning, while blocked, and by the
+	 * deadline; how late the timeouts woke up, in microseconds */
+	unsigned long spin_hits;
+	unsigned long block_hits;
+	unsigned long timeouts;
+	Histogram late;
 };
 
 /************************************************************
 * Local functions declaration
 ************************************************************/
 
-static unsigned long long remaining_time_millis(const Timer t, const int step);
+static unsigned long long step_deadline_nanos(const Timer t, const int step);
+static unsigned long long remaining_time_nanos(const Timer t, const int step);
 static int timed_poll(const Timer t, const int32_t step, const int fd_source, const short events);
+static int timer_spin(const int fd_source, const short events, const int busy, const unsigned long long until);
+static int timer_ready(const int fd_source, const short events, const int busy);
+static int timer_block(const Timer t, const int32_t step, const int fd_source, const short events);
+static int timer_busyPoll(const Timer t, const int fd_source);
 static int timer_check(Timer t, const char * const fname);
 
 /************************************************************
@@ -43,23 +99,226 @@ static int timer_check(Timer t, const char * const fname);
 
 Timer create_timer(const unsigned int speed, const unsigned int queries_per_int)
 {
+	if (0 == queries_per_int) {
+		DEBUG_PRINT("create_timer: invalid queries %u.\n", queries_per_int);
+		return NULL;
+	}
+
 	struct _timer *ret = calloc(1, sizeof(*ret));
 	if (NULL == ret) {
 		return NULL;
 	}
-	if (0 != gettimeofday(&ret->timestamp, NULL)) {
+	if (0 == (ret->anchor = timer_now_nanos())) {
 		free(ret);
 		return NULL;
 	}
+	ret->period = DEFAULT_PERIOD;
+	ret->interval = (0 == speed) ? 0 : (NSEC_PER_SEC * ret->period) / speed;
 	ret->speed = speed;
 	ret->queries_per_int = queries_per_int;
+	ret->fd = -1;
+	timer_forgetFds(ret);
+	if (NULL == (ret->late = hist_init())) {
+		free(ret);
+		return NULL;
+	}
 	return ret;
 }
 
+void destroy_timer(Timer t)
+{
+	if (NULL == t) {
+		return;
+	}
+	if (0 <= t->fd) {
+		close(t->fd);
+	}
+	hist_destroy(t->late);
+	free(t);
+}
+
+/**
+ * Makes read_possible and write_possible wait on a timerfd armed
+ * on the step deadline, rather than on a millisecond poll
+ * timeout. Returns 0 on success, non-zero if timerfd is not
+ * available, in which case the timer keeps using timeouts.
+ */
+int timer_enableFd(Timer t)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_enableFd")) {
+		return -_TIMER_INVALID;
+	}
+	if (0 <= t->fd) {
+		return _TIMER_SUCCESS;
+	}
+#ifdef __linux__
+	if (0 > (t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))) {
+		DEBUG_PRINT("timer_enableFd: timerfd_create failure.\n");
+		return -_TIMER_FAILURE;
+	}
+	return _TIMER_SUCCESS;
+#else
+	return -_TIMER_FAILURE;
+#endif
+}
+
+/**
+ * Selects how [t] waits for data:
+ * - TIMER_WAIT_BLOCK sleeps in poll until data or the deadline;
+ * - TIMER_WAIT_SPIN checks for data without sleeping for up to
+ *   [spin_micros], then sleeps. The spin is halved each time it
+ *   runs out, and doubled each time it catches the data;
+ * - TIMER_WAIT_BUSY never sleeps, and sets SO_BUSY_POLL to
+ *   [spin_micros] on sockets, so that the checks poll the device
+ *   queue.
+ */
+int timer_setWait(Timer t, const TimerWaits wait, const unsigned int spin_micros)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_setWait")) {
+		return -_TIMER_INVALID;
+	}
+	if ((TIMER_WAIT_NUMBER <= wait) || ((TIMER_WAIT_BLOCK != wait) && (0 == spin_micros))) {
+		DEBUG_PRINT("timer_setWait: invalid wait %d or spin %u.\n", wait, spin_micros);
+		return -_TIMER_INVALID;
+	}
+	t->wait = wait;
+	t->spin_max = spin_micros * NSEC_PER_USEC;
+	t->spin = t->spin_max;
+	timer_forgetFds(t);
+	return _TIMER_SUCCESS;
+}
+
+/**
+ * Prints how the waits of [t] ended, to compare the wait
+ * strategies on a given host.
+ */
+void timer_printStats(const Timer t, const char * const name)
+{
+	static const char * const waits[TIMER_WAIT_NUMBER] = { "block", "spin", "busy" };
+	char hist_name[96];
+
+	if (_TIMER_SUCCESS != timer_check(t, "timer_printStats")) {
+		return;
+	}
+	WARNING("%s: %s wait, %lu waits ended spinning, %lu blocked, %lu timed out, spin now %llu us.\n",
+		name, waits[t->wait], t->spin_hits, t->block_hits, t->timeouts, t->spin / NSEC_PER_USEC);
+	snprintf(hist_name, sizeof(hist_name), "%s wake-up past deadline", name);
+	hist_print(t->late, hist_name, "us");
+}
+
+/**
+ * Returns non-zero if [t] runs in lockstep, without deadlines.
+ */
+int timer_isLockstep(const Timer t)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_isLockstep")) {
+		return 0;
+	}
+	return 0 == t->interval;
+}
+
+/**
+ * Changes the speed of [t] from the current step on, 0 switching to
+ * lockstep mode. The hour in progress keeps its start.
+ */
+int timer_setSpeed(Timer t, const unsigned int speed)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_setSpeed")) {
+		return -_TIMER_INVALID;
+	}
+	t->interval = (0 == speed) ? 0 : (NSEC_PER_SEC * t->period) / speed;
+	t->speed = speed;
+	return _TIMER_SUCCESS;
+}
+
+/**
+ * Makes each hour of [t] stand for [seconds] of simulated time
+ * rather than 3600, at the same speed. The hour in progress
+ * keeps its start.
+ */
+int timer_setPeriod(Timer t, const unsigned int seconds)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_setPeriod")) {
+		return -_TIMER_INVALID;
+	}
+	if (0 == seconds) {
+		DEBUG_PRINT("timer_setPeriod: invalid period %u.\n", seconds);
+		return -_TIMER_INVALID;
+	}
+	t->period = seconds;
+	return timer_setSpeed(t, t->speed);
+}
+
+/**
+ * Returns the current speed of [t], 0 in lockstep mode.
+ */
+unsigned int timer_getSpeed(const Timer t)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_getSpeed")) {
+		return 0;
+	}
+	return t->speed;
+}
+
+/**
+ * Lets timer_adapt drive the speed of [t], keeping [slack_percent]
+ * of the first step of each hour free. 0 fixes the speed.
+ */
+int timer_setAdaptive(Timer t, const unsigned int slack_percent)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_setAdaptive")) {
+		return -_TIMER_INVALID;
+	}
+	if (100 <= slack_percent) {
+		DEBUG_PRINT("timer_setAdaptive: invalid slack %u%%.\n", slack_percent);
+		return -_TIMER_INVALID;
+	}
+	t->slack = slack_percent;
+	return _TIMER_SUCCESS;
+}
+
+/**
+ * Accounts for a controller round trip of [rtt_micros] in adaptive
+ * mode. The speed drops at once when a round trip would not fit in
+ * the first step, and rises by an eighth of the margin per hour
+ * otherwise, following the smoothed round trip time.
+ */
+void timer_adapt(Timer t, const unsigned long long rtt_micros)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_adapt")) {
+		return;
+	}
+	if ((0 == t->slack) || (0 == t->interval)) {
+		return;
+	}
+
+	unsigned long long rtt = rtt_micros * NSEC_PER_USEC, target;
+
+	t->rtt = (0 == t->rtt) ? rtt : (7 * t->rtt + rtt) / 8;
+	if (rtt < t->rtt) {
+		rtt = t->rtt;
+	}
+	target = (rtt * t->queries_per_int * 100) / (100 - t->slack);
+
+	if (target > t->interval) {
+		t->interval = target;
+	}
+	else {
+		t->interval -= (t->interval - target) / 8;
+	}
+	if (MAX_INTERVAL(t) < t->interval) {
+		t->interval = MAX_INTERVAL(t);
+	}
+	if (MIN_INTERVAL(t) > t->interval) {
+		t->interval = MIN_INTERVAL(t);
+	}
+	t->speed = (NSEC_PER_SEC * t->period) / t->interval;
+}
+
 /**
  * Returns 0 if no data can be read from [fd_source], non-zero
- * otherwise. Waits up to [NORMAL_TIME_WAIT] seconds for data
- * to become available.
+ * otherwise. Waits until the end of [step] for data to become
+ * available.
  */
 int read_possible(const Timer t, const int32_t step, const int fd_source)
 {
@@ -73,7 +332,6 @@ int write_possible(const Timer t, const int32_t step, const int fd_source)
 
 static int timed_poll(const Timer t, const int32_t step, const int fd_source, const short events)
 {
-//	DEBUG_PRINT("timed_poll: checking...\n");
 	if (_TIMER_SUCCESS != timer_check(t, "timed_poll")) {
 		return 0;
 	}
@@ -81,99 +339,319 @@ static int timed_poll(const Timer t, const int32_t step, const int fd_source, co
 		DEBUG_PRINT("timed_poll: invalid step %d\n", step);
 		return 0;
 	}
+	unsigned long long deadline = (0 == t->interval) ? ULLONG_MAX : step_deadline_nanos(t, step + 1),
+			  until = 0, now;
+	int ready = 0, busy = 0;
+
+	/* Spin until [until], then block until [deadline]. */
+	switch (t->wait) {
+	case TIMER_WAIT_BUSY:
+		busy = timer_busyPoll(t, fd_source);
+		until = deadline;
+		break;
+	case TIMER_WAIT_SPIN:
+		now = timer_now_nanos();
+		until = (deadline > now + t->spin) ? now + t->spin : deadline;
+		break;
+	default:
+		break;
+	}
+
+	if (0 != until) {
+		ready = timer_spin(fd_source, events, busy, until);
+		if (0 < ready) {
+			++t->spin_hits;
+			if (TIMER_WAIT_SPIN == t->wait) {
+				t->spin = (t->spin_max / 2 < t->spin) ? t->spin_max : 2 * t->spin;
+			}
+		}
+		else if ((0 == ready) && (TIMER_WAIT_SPIN == t->wait) && (until < deadline)) {
+			t->spin /= 2;
+			if ((t->spin_max >> SPIN_FLOOR_SHIFT) > t->spin) {
+				t->spin = t->spin_max >> SPIN_FLOOR_SHIFT;
+			}
+		}
+	}
+	if ((0 == ready) && (until < deadline) && timer_block(t, step, fd_source, events)) {
+		++t->block_hits;
+		ready = 1;
+	}
+	if (0 != ready) {
+		return 0 < ready;
+	}
+
+	now = timer_now_nanos();
+	if ((ULLONG_MAX != deadline) && (now >= deadline)) {
+		++t->timeouts;
+		hist_record(t->late, (now - deadline) / NSEC_PER_USEC);
+	}
+	return 0;
+}
+
+/**
+ * Checks [fd_source] for [events] without sleeping, until the
+ * CLOCK_MONOTONIC time [until]. Returns 1 once ready, 0 if
+ * [until] passed, -1 if the fd reported an error or hang-up.
+ * [busy] is non-zero if SO_BUSY_POLL is set on [fd_source].
+ */
+static int timer_spin(const int fd_source, const short events, const int busy, const unsigned long long until)
+{
+	int ready;
+
+	do {
+		if (0 != (ready = timer_ready(fd_source, events, busy))) {
+			return ready;
+		}
+	} while (timer_now_nanos() < until);
+
+	return 0;
+}
+
+/**
+ * Single non-blocking check of [fd_source] for [events], with the
+ * return values of timer_spin. On a busy-polled socket, a peeking
+ * receive makes the kernel poll the device queue.
+ */
+static int timer_ready(const int fd_source, const short events, const int busy)
+{
 	struct pollfd fd_wait = {0};
-	int ret;
+	char c;
+	ssize_t r;
 
-	unsigned long long timeout = remaining_time_millis(t, step + 1);
+	if (busy && (POLLIN == events)) {
+		r = recv(fd_source, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+		if (0 < r) {
+			return 1;
+		}
+		if ((0 > r) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))) {
+			return 0;
+		}
+		/* Closed or failed: let poll report it. */
+	}
 
 	fd_wait.fd = fd_source;
 	fd_wait.events = events;
-
-	DEBUG_PRINT("timed_poll: waiting for %lld milliseconds.\n", timeout);
-	if(0 > (ret = poll(&fd_wait, 1, timeout))) {
-		DEBUG_PRINT("timed_poll: poll failure\n");
+	if (0 >= poll(&fd_wait, 1, 0)) {
 		return 0;
 	}
+	return (events == fd_wait.revents) ? 1 : -1;
+}
 
-	if (events == fd_wait.revents) {
-		return ret;
+/**
+ * Sleeps in poll until [fd_source] is ready for [events] or [step]
+ * is over. Returns non-zero if it is ready.
+ */
+static int timer_block(const Timer t, const int32_t step, const int fd_source, const short events)
+{
+	struct pollfd fd_wait[2] = {{0}};
+	int ret, nfds = 1, timeout = -1;
+
+	fd_wait[0].fd = fd_source;
+	fd_wait[0].events = events;
+
+#ifdef __linux__
+	if ((0 <= t->fd) && (0 != t->interval)) {
+		unsigned long long deadline = step_deadline_nanos(t, step + 1);
+		struct itimerspec when = {{0}};
+
+		when.it_value.tv_sec = deadline / NSEC_PER_SEC;
+		when.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+		if (0 == timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &when, NULL)) {
+			fd_wait[1].fd = t->fd;
+			fd_wait[1].events = POLLIN;
+			nfds = 2;
+		}
 	}
-	else {
+#endif
+	do {
+		if (1 == nfds) {
+			timeout = timer_timeout_millis(t, step);
+		}
+		DEBUG_PRINT("timed_poll: waiting for %d milliseconds.\n", timeout);
+		/* A signal (e.g. a statistics dump) doesn't end the step. */
+	} while ((0 > (ret = poll(fd_wait, nfds, timeout))) && (EINTR == errno));
+
+	if (0 > ret) {
+		DEBUG_PRINT("timed_poll: poll failure\n");
 		return 0;
 	}
+
+	return events == fd_wait[0].revents;
 }
 
 /**
- * Waits for poll to be ready, for up to [tv_init] + 1 hour.
+ * Forgets the sockets SO_BUSY_POLL was set on, when their file
+ * descriptors are closed and may be reused by new sockets.
  */
-//int wait_for_answer(const int fd_source)
-//{
-////	DEBUG_PRINT("wait_for_answer: waiting...\n");
-//	int ret;
-//	struct pollfd fd_wait = {0};
-//	unsigned long time_left = remaining_time_millis();
-//
-//	fd_wait.fd = fd_source;
-//	fd_wait.events = POLLIN;
-//
-//	if(0 > (ret = poll(&fd_wait, 1, time_left * 1000L))) {
-//		ERROR("wait_for_answer: poll failure\n");
-//	}
-//
-//	return ret;
-//}
+void timer_forgetFds(Timer t)
+{
+	int i;
 
-//int time_is_up(void)
-//{
-//	return remaining_time_millis() != 0;
-//}
+	if (_TIMER_SUCCESS != timer_check(t, "timer_forgetFds")) {
+		return;
+	}
+	for (i = 0; i < BUSY_FDS; ++i) {
+		t->busy_fd[i] = -1;
+		t->busy_ok[i] = 0;
+	}
+	t->busy_next = 0;
+}
 
 /**
- * Sets the local timeout values.
+ * Sets SO_BUSY_POLL on [fd_source], once per socket. Returns
+ * non-zero if it is set.
  */
-//void setup_timer(const unsigned int param_simulation_speed, const unsigned int param_queries_per_int)
-//{
-//	DEBUG_PRINT("setup_timer: simulation speed was %d, is now %d\n", simulation_speed, param_simulation_speed);
-//	simulation_speed = param_simulation_speed;
-//
-//	DEBUG_PRINT("setup_timer: queries per interval was %d, is now %d\n", queries_per_int, param_queries_per_int);
-//	queries_per_int  = param_queries_per_int;
-//}
+static int timer_busyPoll(const Timer t, const int fd_source)
+{
+	int i;
+
+	for (i = 0; i < BUSY_FDS; ++i) {
+		if (fd_source == t->busy_fd[i]) {
+			return t->busy_ok[i];
+		}
+	}
+	i = t->busy_next;
+	t->busy_next = (i + 1) % BUSY_FDS;
+	t->busy_fd[i] = fd_source;
+	t->busy_ok[i] = 0;
+#ifdef SO_BUSY_POLL
+	int usecs = (int) (t->spin_max / NSEC_PER_USEC);
+
+	t->busy_ok[i] = (0 == setsockopt(fd_source, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)));
+	if (!t->busy_ok[i]) {
+		DEBUG_PRINT("timer_busyPoll: SO_BUSY_POLL refused on fd %d, spinning on poll.\n", fd_source);
+	}
+#endif
+	return t->busy_ok[i];
+}
 
 /**
- * Sets the local timeval to the current time.
+ * Returns the number of milliseconds left before the end of
+ * [step], rounded up and clamped to INT_MAX, as a poll/epoll
+ * timeout. Returns -1, wait forever, in lockstep mode.
  */
-int reset_timer(Timer t)
+int timer_timeout_millis(const Timer t, const int32_t step)
 {
-	return gettimeofday(&t->timestamp, NULL);
+	if (_TIMER_SUCCESS != timer_check(t, "timer_timeout_millis")) {
+		return 0;
+	}
+	if((step < 0) || (step >= t->queries_per_int)) {
+		DEBUG_PRINT("timer_timeout_millis: invalid step %d\n", step);
+		return 0;
+	}
+	if (0 == t->interval) {
+		return -1;
+	}
+
+	unsigned long long timeout = (remaining_time_nanos(t, step + 1) + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+
+	return (INT_MAX < timeout) ? INT_MAX : (int) timeout;
 }
 
 /**
- * Returns the time left in the current step, in milliseconds
+ * Returns the number of microseconds left before the end of
+ * [step], 0 if it is over or in lockstep mode.
  */
-static unsigned long long remaining_time_millis(const Timer t, const int step)
+unsigned long long timer_remaining_micros(const Timer t, const int32_t step)
 {
-	if (_TIMER_SUCCESS != timer_check(t, "remaining_time_millis")) {
+	if (_TIMER_SUCCESS != timer_check(t, "timer_remaining_micros")) {
 		return 0;
 	}
-	if((step <= 0) || (step > t->queries_per_int)) {
-		DEBUG_PRINT("remaining_time_millis: invalid step %d\n", step);
+	if ((step < 0) || (step >= t->queries_per_int) || (0 == t->interval)) {
 		return 0;
 	}
-	struct timeval now;
+	return remaining_time_nanos(t, step + 1) / NSEC_PER_USEC;
+}
 
-	if (0 != gettimeofday(&now, NULL)) {
+/**
+ * Returns the wall clock duration of a whole communication
+ * interval, in microseconds, 0 in lockstep mode.
+ */
+unsigned long long timer_interval_micros(const Timer t)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "timer_interval_micros")) {
 		return 0;
 	}
+	return t->interval / 1000ULL;
+}
+
+/**
+ * Returns the current time in microseconds, to measure latencies.
+ */
+unsigned long long timer_now_micros(void)
+{
+	return timer_now_nanos() / 1000ULL;
+}
+
+/**
+ * Returns the current CLOCK_MONOTONIC time in nanoseconds, 0 on
+ * failure.
+ */
+unsigned long long timer_now_nanos(void)
+{
+	struct timespec now;
+
+	if (0 != clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+	return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+/**
+ * Starts the next hour on the schedule, one interval after the
+ * previous one, but neither in the future nor more than an
+ * interval in the past.
+ */
+int reset_timer(Timer t)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "reset_timer")) {
+		return -_TIMER_INVALID;
+	}
+	unsigned long long now = timer_now_nanos();
 
-	unsigned long long time_left = 0,
-			  max_time = t->timestamp.tv_sec * 1000ULL + (((1000ULL * step * DEFAULT_TIMEOUT) / t->queries_per_int)/ t->speed) + t->timestamp.tv_usec / 1000ULL,
-			  now_time = now.tv_sec * 1000ULL + now.tv_usec / 1000ULL;
-	if(max_time > now_time) {
-		time_left = max_time - now_time;
+	if (0 == now) {
+		return -_TIMER_FAILURE;
 	}
 
-	return time_left;
+	t->anchor += t->interval;
+	if ((t->anchor > now) || (0 == t->interval)) {
+		t->anchor = now;
+	}
+	else if (now - t->anchor >= t->interval) {
+		DEBUG_PRINT("reset_timer: %llu nanoseconds behind schedule, re-anchoring.\n", now - t->anchor);
+		t->anchor = now;
+	}
+
+	return _TIMER_SUCCESS;
+}
+
+/**
+ * Returns the CLOCK_MONOTONIC time at which [step] ends, in
+ * nanoseconds. Computed from the hour start so that the step
+ * lengths don't accumulate rounding errors.
+ */
+static unsigned long long step_deadline_nanos(const Timer t, const int step)
+{
+	return t->anchor + (t->interval * step) / t->queries_per_int;
+}
+
+/**
+ * Returns the time left in the current step, in nanoseconds
+ */
+static unsigned long long remaining_time_nanos(const Timer t, const int step)
+{
+	if (_TIMER_SUCCESS != timer_check(t, "remaining_time_nanos")) {
+		return 0;
+	}
+	if((step <= 0) || (step > t->queries_per_int)) {
+		DEBUG_PRINT("remaining_time_nanos: invalid step %d\n", step);
+		return 0;
+	}
+
+	unsigned long long now = timer_now_nanos(),
+			  deadline = step_deadline_nanos(t, step);
+
+	return (deadline > now) ? deadline - now : 0;
 }
 
 static int timer_check(Timer t, const char * const fname)
@@ -184,4 +662,3 @@ static int timer_check(Timer t, const char * const fname)
 	}
 	return _TIMER_SUCCESS;
 }
-
@@ -0,0 +1,458 @@
+#include <Uring.h>
+
+#include <Debug.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _URING_SUCCESS	0
+#define _URING_INVALID	-1
+#define _URING_FAILED	-2
+
+/* A chain is at most a send, a receive and their timeout. */
+#define _URING_ENTRIES	4
+
+/************************************************************
+* Local structs
+************************************************************/
+
+#ifdef HAVE_IO_URING
+
+/* Operations of a chain, used as user_data of their SQE. */
+enum _uring_ops {
+	_URING_SEND = 0,
+	_URING_RECV,
+	_URING_TIMEOUT,
+	_URING_OPS_NUMBER
+};
+
+struct _uring {
+	int fd;
+
+	/* Submission ring. */
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+
+	/* Completion ring. */
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	/* SQEs prepared but not submitted yet. */
+	unsigned queued;
+	/* SQEs submitted and not completed yet. */
+	unsigned pending;
+	int results[_URING_OPS_NUMBER];
+
+	/* Arguments that must outlive the submission. */
+	struct __kernel_timespec timeout;
+	struct msghdr msg;
+};
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static struct io_uring_sqe *uring_sqe(Uring u, const enum _uring_ops op, const int fd);
+static void uring_linkTimeout(Uring u, const int timeout);
+static int uring_submit(Uring u);
+static void uring_reap(Uring u);
+static int uring_recvResult(struct socket_singleton *socket, const int res);
+
+#endif
+
+static int uring_check(Uring u, const char * const fname);
+
+/************************************************************
+* Function definition
+************************************************************/
+
+#ifdef HAVE_IO_URING
+
+/**
+ * Sets up a small io_uring instance. Returns NULL if the kernel
+ * lacks io_uring, forbids it, or is too old to link a timeout to
+ * a socket receive (IORING_FEAT_FAST_POLL, Linux 5.7).
+ */
+Uring uring_create(void)
+{
+	struct io_uring_params p;
+	struct _uring *u = calloc(1, sizeof(*u));
+	char *ring;
+
+	if (NULL == u) {
+		return NULL;
+	}
+
+	memset(&p, 0, sizeof(p));
+	u->fd = syscall(__NR_io_uring_setup, _URING_ENTRIES, &p);
+	if (0 > u->fd) {
+		DEBUG_PRINT("uring_create: io_uring_setup failed with errno %d.\n", errno);
+		free(u);
+		return NULL;
+	}
+	if (!(p.features & IORING_FEAT_FAST_POLL)) {
+		DEBUG_PRINT("uring_create: kernel too old (features 0x%x).\n", p.features);
+		close(u->fd);
+		free(u);
+		return NULL;
+	}
+
+	u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_ring_size > u->sq_ring_size) {
+			u->sq_ring_size = u->cq_ring_size;
+		}
+		u->cq_ring_size = u->sq_ring_size;
+	}
+	u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if (MAP_FAILED == u->sq_ring) {
+		close(u->fd);
+		free(u);
+		return NULL;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		u->cq_ring = u->sq_ring;
+	}
+	else {
+		u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+	}
+	u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if ((MAP_FAILED == u->cq_ring) || (MAP_FAILED == u->sqes)) {
+		u->cq_ring = (MAP_FAILED == u->cq_ring) ? u->sq_ring : u->cq_ring;
+		u->sqes = (MAP_FAILED == u->sqes) ? NULL : u->sqes;
+		uring_destroy(u);
+		return NULL;
+	}
+
+	ring = u->sq_ring;
+	u->sq_tail = (unsigned *) (ring + p.sq_off.tail);
+	u->sq_mask = (unsigned *) (ring + p.sq_off.ring_mask);
+	u->sq_array = (unsigned *) (ring + p.sq_off.array);
+
+	ring = u->cq_ring;
+	u->cq_head = (unsigned *) (ring + p.cq_off.head);
+	u->cq_tail = (unsigned *) (ring + p.cq_off.tail);
+	u->cq_mask = (unsigned *) (ring + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+
+	DEBUG_PRINT("uring_create: %u entries, features 0x%x.\n", p.sq_entries, p.features);
+
+	return u;
+}
+
+int uring_destroy(Uring u)
+{
+	if (_URING_SUCCESS != uring_check(u, "uring_destroy")) {
+		return _URING_INVALID;
+	}
+
+	if (NULL != u->sqes) {
+		munmap(u->sqes, u->sqes_size);
+	}
+	if (u->cq_ring != u->sq_ring) {
+		munmap(u->cq_ring, u->cq_ring_size);
+	}
+	munmap(u->sq_ring, u->sq_ring_size);
+	close(u->fd);
+	free(u);
+
+	return _URING_SUCCESS;
+}
+
+/**
+ * Fills the empty read buffer of [socket] with a RECV linked to
+ * a [timeout] milliseconds timeout (none if negative), in a single
+ * io_uring_enter.
+ * Returns non-zero if data was read, 0 on timeout or if the
+ * connection was closed.
+ */
+int uring_recv(Uring u, struct socket_singleton *socket, const int timeout)
+{
+	if (_URING_SUCCESS != uring_check(u, "uring_recv")) {
+		return 0;
+	}
+
+	struct io_uring_sqe *sqe = uring_sqe(u, _URING_RECV, socket->accept_fd);
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->addr = (uintptr_t) socket_prepareRead(socket);
+	sqe->len = SOCKET_BUFFER_SIZE;
+	if (0 < timeout) {
+		sqe->flags = IOSQE_IO_LINK;
+		uring_linkTimeout(u, timeout);
+	}
+	else if (0 == timeout) {
+		sqe->msg_flags = MSG_DONTWAIT;
+	}
+
+	if (uring_submit(u)) {
+		ERROR("uring_recv: io_uring_enter failed\n");
+	}
+
+	return uring_recvResult(socket, u->results[_URING_RECV]);
+}
+
+/**
+ * Sends everything gathered by socket_write on [out], followed
+ * by [count] bytes of [buf], like send_complete. If [in] has
+ * nothing buffered, a RECV for the answer is chained behind the
+ * send, with a [timeout] milliseconds timeout, so that the answer
+ * is already buffered when the caller looks for it.
+ */
+void uring_flush(Uring u, struct socket_singleton *out, const char * const buf, const size_t count,
+	struct socket_singleton *in, const int timeout)
+{
+	struct iovec iov[2], *left = iov;
+	int iovcnt = 0, prefetch, res;
+	struct io_uring_sqe *sqe;
+
+	if (0 < out->write_len) {
+		iov[iovcnt].iov_base = out->write_buf;
+		iov[iovcnt].iov_len = out->write_len;
+		++iovcnt;
+	}
+	if (0 < count) {
+		iov[iovcnt].iov_base = (char *) buf;
+		iov[iovcnt].iov_len = count;
+		++iovcnt;
+	}
+	if (0 == iovcnt) {
+		return;
+	}
+	if (_URING_SUCCESS != uring_check(u, "uring_flush")) {
+		send_frame(out, iov, iovcnt);
+		out->write_len = 0;
+		return;
+	}
+
+	prefetch = (0 != timeout) && (NULL != in) && in->started && (0 == socket_buffered(in));
+
+	memset(&u->msg, 0, sizeof(u->msg));
+	u->msg.msg_iov = iov;
+	u->msg.msg_iovlen = iovcnt;
+
+	sqe = uring_sqe(u, _URING_SEND, out->accept_fd);
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->addr = (uintptr_t) &u->msg;
+	sqe->len = 1;
+	/* A short send fails the link, so that the receive isn't
+	 * waiting for an answer to a frame that wasn't sent. */
+	sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+
+	if (prefetch) {
+		sqe->flags = IOSQE_IO_LINK;
+		sqe = uring_sqe(u, _URING_RECV, in->accept_fd);
+		sqe->opcode = IORING_OP_RECV;
+		sqe->addr = (uintptr_t) socket_prepareRead(in);
+		sqe->len = SOCKET_BUFFER_SIZE;
+		if (0 < timeout) {
+			sqe->flags = IOSQE_IO_LINK;
+			uring_linkTimeout(u, timeout);
+		}
+	}
+
+	if (uring_submit(u)) {
+		ERROR("uring_flush: io_uring_enter failed\n");
+	}
+	++out->stats.send_calls;
+
+	res = u->results[_URING_SEND];
+	if (0 > res) {
+		/* Nothing was sent: send_frame retries, or reports the
+		 * closed connection. */
+		send_frame(out, iov, iovcnt);
+	}
+	else {
+		out->stats.bytes_sent += res;
+		while ((0 < iovcnt) && (left->iov_len <= (size_t) res)) {
+			res -= left->iov_len;
+			++left;
+			--iovcnt;
+		}
+		if (0 < iovcnt) {
+			++out->stats.partial_sends;
+			left->iov_base = (char *) left->iov_base + res;
+			left->iov_len -= res;
+			send_frame(out, left, iovcnt);
+		}
+	}
+	out->write_len = 0;
+
+	if (prefetch) {
+		uring_recvResult(in, u->results[_URING_RECV]);
+	}
+}
+
+/**
+ * Returns a cleared SQE for [op] on [fd], queued for the next
+ * uring_submit.
+ */
+static struct io_uring_sqe *uring_sqe(Uring u, const enum _uring_ops op, const int fd)
+{
+	unsigned index = (*u->sq_tail + u->queued) & *u->sq_mask;
+	struct io_uring_sqe *sqe = &u->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->fd = fd;
+	sqe->user_data = op;
+	u->sq_array[index] = index;
+	u->results[op] = -ECANCELED;
+	++u->queued;
+
+	return sqe;
+}
+
+/**
+ * Bounds the previously queued SQE to [timeout] milliseconds.
+ */
+static void uring_linkTimeout(Uring u, const int timeout)
+{
+	struct io_uring_sqe *sqe = uring_sqe(u, _URING_TIMEOUT, -1);
+
+	u->timeout.tv_sec = timeout / 1000;
+	u->timeout.tv_nsec = (timeout % 1000) * 1000000L;
+
+	sqe->opcode = IORING_OP_LINK_TIMEOUT;
+	sqe->addr = (uintptr_t) &u->timeout;
+	sqe->len = 1;
+}
+
+/**
+ * Submits the queued SQEs and waits for all of them to complete.
+ * Returns 0 on success, non-zero on failure.
+ */
+static int uring_submit(Uring u)
+{
+	int ret;
+	unsigned submit = u->queued;
+
+	__atomic_store_n(u->sq_tail, *u->sq_tail + u->queued, __ATOMIC_RELEASE);
+	u->pending += u->queued;
+	u->queued = 0;
+
+	while (0 < u->pending) {
+		ret = syscall(__NR_io_uring_enter, u->fd, submit, u->pending, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (0 > ret) {
+			if (EINTR == errno) {
+				continue;
+			}
+			DEBUG_PRINT("uring_submit: io_uring_enter failed with errno %d.\n", errno);
+			return _URING_FAILED;
+		}
+		submit -= ((unsigned) ret < submit) ? (unsigned) ret : submit;
+		uring_reap(u);
+	}
+
+	return _URING_SUCCESS;
+}
+
+/**
+ * Stores the result of every completed operation.
+ */
+static void uring_reap(Uring u)
+{
+	unsigned head = *u->cq_head;
+	unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	struct io_uring_cqe *cqe;
+
+	while (head != tail) {
+		cqe = &u->cqes[head & *u->cq_mask];
+		if (_URING_OPS_NUMBER > cqe->user_data) {
+			u->results[cqe->user_data] = cqe->res;
+		}
+		++head;
+		--u->pending;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Accounts for the RECV result [res] on [socket]. Like poll
+ * waits, receives that timed out aren't counted. Returns
+ * non-zero if data was read.
+ */
+static int uring_recvResult(struct socket_singleton *socket, const int res)
+{
+	switch (res) {
+	case -ECANCELED:	/* timed out */
+	case -ETIME:
+	case -EAGAIN:
+	case -EINTR:
+		return 0;
+	default:
+		++socket->stats.recv_calls;
+		return 0 == socket_commitRead(socket, res, 0);
+	}
+}
+
+#else /* HAVE_IO_URING */
+
+/**
+ * The backend isn't built in: callers keep using poll.
+ */
+Uring uring_create(void)
+{
+	return NULL;
+}
+
+int uring_destroy(Uring u)
+{
+	return _URING_INVALID;
+}
+
+int uring_recv(Uring u, struct socket_singleton *socket, const int timeout)
+{
+	uring_check(u, "uring_recv");
+	return 0;
+}
+
+void uring_flush(Uring u, struct socket_singleton *out, const char * const buf, const size_t count,
+	struct socket_singleton *in, const int timeout)
+{
+	uring_check(u, "uring_flush");
+	if (0 < count) {
+		send_complete(out, buf, count);
+	}
+	else {
+		socket_flush(out);
+	}
+}
+
+#endif /* HAVE_IO_URING */
+
+static int uring_check(Uring u, const char * const fname)
+{
+	if (NULL == u) {
+		DEBUG_PRINT("%s: NULL pointer argument.\n", fname);
+		return _URING_INVALID;
+	}
+	return _URING_SUCCESS;
+}
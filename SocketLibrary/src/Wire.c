@@ -0,0 +1,211 @@
+#include <Wire.h>
+
+#include <Debug.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/************************************************************
+* Defines
+************************************************************/
+
+#define _WIRE_SUCCESS	0
+#define _WIRE_INVALID	-1
+#define _WIRE_FAILED	-2
+
+/************************************************************
+* Local functions declaration
+************************************************************/
+
+static void wire_skip(struct socket_singleton *socket, uint32_t length);
+
+/************************************************************
+* Handshake functions
+************************************************************/
+
+/**
+ * Server side of the handshake, called once the CONTROL_HELLO
+ * control word has been read from [socket]. Reads the peer hello,
+ * answers with the agreed version and capabilities and stores
+ * them in [agreed].
+ * Returns 0 on success, non-zero on failure.
+ */
+int wire_accept(struct socket_singleton *socket, struct wire_hello *agreed)
+{
+	if ((NULL == socket) || (NULL == agreed)) {
+		DEBUG_PRINT("wire_accept: NULL pointer argument.\n");
+		return _WIRE_INVALID;
+	}
+
+	struct wire_hello peer;
+	int32_t control = CONTROL_HELLO;
+
+	recv_complete(socket, (char *) &peer, sizeof(peer));
+	if (!socket->started) {
+		return _WIRE_FAILED;
+	}
+
+	memset(agreed, 0, sizeof(*agreed));
+	agreed->version = (WIRE_VERSION < peer.version) ? WIRE_VERSION : peer.version;
+	agreed->caps = peer.caps & WIRE_SERVER_CAPS;
+	if (0 == agreed->version) {
+		agreed->caps = 0;
+	}
+
+	socket_write(socket, (char *) &control, sizeof(control));
+	send_complete(socket, (char *) agreed, sizeof(*agreed));
+
+	DEBUG_PRINT("wire_accept: peer offered version %d caps 0x%x, agreed version %d caps 0x%x.\n",
+		peer.version, peer.caps, agreed->version, agreed->caps);
+
+	return socket->started ? _WIRE_SUCCESS : _WIRE_FAILED;
+}
+
+/**
+ * Controller side of the handshake: offers [caps] and stores the
+ * server answer in [agreed].
+ * Returns 0 on success, non-zero on failure.
+ */
+int wire_connect(struct socket_singleton *socket, const uint32_t caps, struct wire_hello *agreed)
+{
+	if ((NULL == socket) || (NULL == agreed)) {
+		DEBUG_PRINT("wire_connect: NULL pointer argument.\n");
+		return _WIRE_INVALID;
+	}
+
+	struct wire_hello hello = {0};
+	int32_t control = CONTROL_HELLO;
+
+	hello.version = WIRE_VERSION;
+	hello.caps = caps;
+
+	socket_write(socket, (char *) &control, sizeof(control));
+	send_complete(socket, (char *) &hello, sizeof(hello));
+
+	recv_complete(socket, (char *) &control, sizeof(control));
+	recv_complete(socket, (char *) agreed, sizeof(*agreed));
+	if ((!socket->started) || (CONTROL_HELLO != control)) {
+		DEBUG_PRINT("wire_connect: server does not speak the framed protocol.\n");
+		return _WIRE_FAILED;
+	}
+
+	return _WIRE_SUCCESS;
+}
+
+/************************************************************
+* Frame functions
+************************************************************/
+
+/**
+ * Writes a header for a [type] frame of [length] payload bytes at
+ * the beginning of [frame], which must have WIRE_HEADER_SIZE bytes
+ * reserved before the payload.
+ */
+void wire_setHeader(char *frame, const WireTypes type, const uint32_t length)
+{
+	struct wire_header h = {0};
+
+	h.length = length;
+	h.type = type;
+	memcpy(frame, &h, WIRE_HEADER_SIZE);
+}
+
+/**
+ * Sends a [type] frame carrying [length] bytes of [payload], in a
+ * single send.
+ */
+void wire_send(struct socket_singleton *socket, const WireTypes type, const void * const payload, const uint32_t length)
+{
+	char header[WIRE_HEADER_SIZE];
+
+	if (WIRE_MAX_PAYLOAD < length) {
+		ERROR("wire_send: payload of %u bytes is too long.\n", length);
+	}
+
+	wire_setHeader(header, type, length);
+	if (0 == length) {
+		send_complete(socket, header, WIRE_HEADER_SIZE);
+		return;
+	}
+	socket_write(socket, header, WIRE_HEADER_SIZE);
+	send_complete(socket, payload, length);
+}
+
+/**
+ * Reads a whole frame, which must be of [type], into [payload].
+ * Returns the payload length, or a negative value if the frame is
+ * of another type, does not fit in [max_length] bytes, or the
+ * connection was closed. Refused frames are skipped, so that the
+ * stream stays in sync.
+ */
+int wire_recv(struct socket_singleton *socket, const WireTypes type, void *payload, const uint32_t max_length)
+{
+	struct wire_header h;
+
+	recv_complete(socket, (char *) &h, WIRE_HEADER_SIZE);
+	if (!socket->started) {
+		return _WIRE_FAILED;
+	}
+	if ((type != h.type) || (max_length < h.length)) {
+		WARNING("wire_recv: got frame type %d of %u bytes, expected type %d of at most %u bytes.\n",
+			h.type, h.length, type, max_length);
+		wire_skip(socket, h.length);
+		return _WIRE_INVALID;
+	}
+	if (0 < h.length) {
+		recv_complete(socket, payload, h.length);
+		if (!socket->started) {
+			return _WIRE_FAILED;
+		}
+	}
+
+	return (int) h.length;
+}
+
+/**
+ * Reads a whole frame of any type into [payload], and its type into
+ * [type]. Returns the payload length, or a negative value if the
+ * frame does not fit in [max_length] bytes (it is then skipped) or
+ * the connection was closed.
+ */
+int wire_recvAny(struct socket_singleton *socket, WireTypes *type, void *payload, const uint32_t max_length)
+{
+	struct wire_header h;
+
+	recv_complete(socket, (char *) &h, WIRE_HEADER_SIZE);
+	if (!socket->started) {
+		return _WIRE_FAILED;
+	}
+	*type = h.type;
+	if (max_length < h.length) {
+		WARNING("wire_recvAny: got frame type %d of %u bytes, expected at most %u bytes.\n",
+			h.type, h.length, max_length);
+		wire_skip(socket, h.length);
+		return _WIRE_INVALID;
+	}
+	if (0 < h.length) {
+		recv_complete(socket, payload, h.length);
+		if (!socket->started) {
+			return _WIRE_FAILED;
+		}
+	}
+
+	return (int) h.length;
+}
+
+/**
+ * Discards [length] bytes of payload.
+ */
+static void wire_skip(struct socket_singleton *socket, uint32_t length)
+{
+	char sink[256];
+	uint32_t chunk;
+
+	while ((0 < length) && socket->started) {
+		chunk = (sizeof(sink) < length) ? sizeof(sink) : length;
+		recv_complete(socket, sink, chunk);
+		length -= chunk;
+	}
+}
@@ -0,0 +1,236 @@
+#include <Gorilla.h>
+#include <House.h>
+#include <Timer.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/************************************************************
+* MEAS compression benchmark
+*
+* Plays the hours of a profiles.csv file as the MEAS stream of
+* the built-in schema, and reports the compression ratio and
+* the encode and decode times per frame, for a few batch
+* sizes:
+*
+*     bench_Gorilla [profiles.csv] [hours per frame]
+*
+* The measures are energy = consumption - production, both
+* columns as they are, the charge of a battery storing the
+* production surplus, the PHEV charge while connected and its
+* ready hours.
+************************************************************/
+
+#define DEFAULT_PROFILES	"../profiles.csv"
+#define LINE_LENGTH		512
+#define BATTERY_KWH		10.0
+/* Each timing runs for at least this long. */
+#define MIN_NANOS		200000000ULL
+
+/* Frames of a batch size, encoded back to back. */
+struct frames {
+	int count;
+	int per_frame;
+	uint8_t *data;
+	size_t *offsets;
+	size_t room;
+};
+
+/* Returns field [index] of the CSV [line], 0 if empty. */
+static double field(const char *line, const int index)
+{
+	int i;
+
+	for (i = 0; (i < index) && (NULL != line); ++i) {
+		if (NULL != (line = strchr(line, ','))) {
+			++line;
+		}
+	}
+	return ((NULL == line) || (',' == *line) || ('\n' == *line)) ? 0.0 : atof(line);
+}
+
+/* Loads the hours of [path] to [values], MEAS_NUMBER a row.
+ * Returns the number of hours, 0 on failure. */
+static int load_profiles(const char * const path, double **values)
+{
+	char line[LINE_LENGTH];
+	double consumption, production, battery = 0.0, *v;
+	int hours = 0, room = 1024;
+	FILE *f = fopen(path, "r");
+
+	if ((NULL == f) || (NULL == fgets(line, sizeof(line), f))) {
+		fprintf(stderr, "bench_Gorilla: unable to read \"%s\".\n", path);
+		if (NULL != f) {
+			fclose(f);
+		}
+		return 0;
+	}
+	*values = malloc(room * MEAS_NUMBER * sizeof(double));
+	while ((NULL != *values) && (NULL != fgets(line, sizeof(line), f))) {
+		if (hours == room) {
+			room *= 2;
+			*values = realloc(*values, room * MEAS_NUMBER * sizeof(double));
+			if (NULL == *values) {
+				break;
+			}
+		}
+		consumption = field(line, 2);
+		production = field(line, 3);
+		battery += production - consumption;
+		battery = (0.0 > battery) ? 0.0 : (BATTERY_KWH < battery) ? BATTERY_KWH : battery;
+
+		v = *values + hours * MEAS_NUMBER;
+		v[MEAS_ENERGY] = consumption - production;
+		v[MEAS_CONSUMPTION] = consumption;
+		v[MEAS_PRODUCTION] = production;
+		v[MEAS_BATTERY] = battery;
+		v[MEAS_PHEV] = field(line, 4);
+		v[MEAS_PHEV_READY_HOURS] = field(line, 6);
+		++hours;
+	}
+	fclose(f);
+
+	if (NULL == *values) {
+		fprintf(stderr, "bench_Gorilla: out of memory.\n");
+		return 0;
+	}
+	return hours;
+}
+
+/* Codes the [hours] rows of [values] to [frames], from a reset
+ * [g]. Returns the bytes written. */
+static size_t encode(Gorilla g, const double *values, const int hours, struct frames *frames)
+{
+	struct gorilla_stream stream;
+	size_t pos = 0;
+	int32_t count;
+	int frame, h, i;
+
+	gorilla_reset(g);
+	for (frame = 0, h = 0; frame < frames->count; ++frame) {
+		count = (hours - h < frames->per_frame) ? hours - h : frames->per_frame;
+		frames->offsets[frame] = pos;
+		memcpy(frames->data + pos, &count, sizeof(int32_t));
+		pos += sizeof(int32_t);
+		gorilla_open(&stream, frames->data + pos, frames->room - pos);
+		for (; 0 < count; --count, ++h) {
+			if (gorilla_putControl(g, &stream, h + 1)) {
+				exit(EXIT_FAILURE);
+			}
+			for (i = 0; i < MEAS_NUMBER; ++i) {
+				if (gorilla_putValue(g, &stream, i, values[h * MEAS_NUMBER + i])) {
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+		pos += gorilla_close(&stream);
+	}
+	frames->offsets[frame] = pos;
+	return pos;
+}
+
+/* Decodes [frames] to [values], from a reset [g]. */
+static void decode(Gorilla g, double *values, struct frames *frames)
+{
+	struct gorilla_stream stream;
+	size_t start;
+	int32_t count, control;
+	int frame, h = 0, i;
+
+	gorilla_reset(g);
+	for (frame = 0; frame < frames->count; ++frame) {
+		start = frames->offsets[frame];
+		memcpy(&count, frames->data + start, sizeof(int32_t));
+		start += sizeof(int32_t);
+		gorilla_open(&stream, frames->data + start, frames->offsets[frame + 1] - start);
+		for (; 0 < count; --count, ++h) {
+			if (gorilla_getControl(g, &stream, &control) || (h + 1 != control)) {
+				exit(EXIT_FAILURE);
+			}
+			for (i = 0; i < MEAS_NUMBER; ++i) {
+				if (gorilla_getValue(g, &stream, i, &values[h * MEAS_NUMBER + i])) {
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+}
+
+/* Benchmarks frames of [per_frame] of the [hours] rows. */
+static void bench(const double *values, const int hours, const int per_frame)
+{
+	struct frames frames;
+	Gorilla g = gorilla_init(MEAS_NUMBER);
+	double *decoded = malloc(hours * MEAS_NUMBER * sizeof(double));
+	size_t raw, compressed;
+	unsigned long long start, encode_nanos, decode_nanos;
+	unsigned long encodes, decodes;
+
+	frames.per_frame = per_frame;
+	frames.count = (hours + per_frame - 1) / per_frame;
+	frames.room = frames.count * sizeof(int32_t) + hours * gorilla_maxSize(MEAS_NUMBER);
+	frames.data = malloc(frames.room);
+	frames.offsets = malloc((frames.count + 1) * sizeof(size_t));
+	if ((NULL == g) || (NULL == decoded) || (NULL == frames.data) || (NULL == frames.offsets)) {
+		fprintf(stderr, "bench_Gorilla: out of memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Check the round trip, bit for bit. */
+	compressed = encode(g, values, hours, &frames);
+	decode(g, decoded, &frames);
+	if (0 != memcmp(values, decoded, hours * MEAS_NUMBER * sizeof(double))) {
+		fprintf(stderr, "bench_Gorilla: decoded hours differ.\n");
+		exit(EXIT_FAILURE);
+	}
+	raw = frames.count * sizeof(int32_t) + hours * (sizeof(int32_t) + MEAS_NUMBER * sizeof(double));
+
+	start = timer_now_nanos();
+	for (encodes = 0; timer_now_nanos() - start < MIN_NANOS; ++encodes) {
+		encode(g, values, hours, &frames);
+	}
+	encode_nanos = timer_now_nanos() - start;
+	start = timer_now_nanos();
+	for (decodes = 0; timer_now_nanos() - start < MIN_NANOS; ++decodes) {
+		decode(g, decoded, &frames);
+	}
+	decode_nanos = timer_now_nanos() - start;
+
+	printf("%4d hours/frame: %6.1f B/frame raw, %6.1f B/frame compressed, ratio %5.2f, "
+		"encode %8.1f ns/frame, decode %8.1f ns/frame\n",
+		per_frame, (double) raw / frames.count, (double) compressed / frames.count,
+		(double) raw / compressed, (double) encode_nanos / encodes / frames.count,
+		(double) decode_nanos / decodes / frames.count);
+
+	free(frames.data);
+	free(frames.offsets);
+	free(decoded);
+	gorilla_destroy(g);
+}
+
+int main(int argc, char *argv[])
+{
+	static const int batches[] = { 1, 24, BATCH_MAX_HOURS };
+	const char *path = (1 < argc) ? argv[1] : DEFAULT_PROFILES;
+	double *values = NULL;
+	int hours, i;
+
+	if (0 == (hours = load_profiles(path, &values))) {
+		return EXIT_FAILURE;
+	}
+	printf("%s: %d hours of %d measures.\n", path, hours, MEAS_NUMBER);
+
+	if (2 < argc) {
+		bench(values, hours, (0 < atoi(argv[2])) ? atoi(argv[2]) : 1);
+	}
+	else {
+		for (i = 0; i < (int) (sizeof(batches) / sizeof(batches[0])); ++i) {
+			bench(values, hours, batches[i]);
+		}
+	}
+
+	free(values);
+	return EXIT_SUCCESS;
+}
@@ -7,6 +7,14 @@
 #include <ControlBuffer.h>
 #include <House.h>
 #include <Fifo.h>
+#include <HouseServer.h>
+#include <Config.h>
+#include <ShmTransport.h>
+#include <Wire.h>
+#include <Uring.h>
+#include <Spsc.h>
+#include <Histogram.h>
+#include <Gorilla.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -18,6 +26,9 @@
 #include <string.h>
 #include <poll.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
 
 /************************************************************
 * Local enums and defines
@@ -27,72 +38,737 @@ typedef enum _comms_status {
 	COMMS_MEAS_WAIT = 0,
 	COMMS_MEAS_SEND,
 	COMMS_CMDS_WAIT,
-	COMMS_CMDS_RECV
+	COMMS_CMDS_RECV,
+	COMMS_NUMBER
 } CommsStatus;
 
+static const char * const comms_status_names[COMMS_NUMBER] = {
+	"MEAS_WAIT", "MEAS_SEND", "CMDS_WAIT", "CMDS_RECV"
+};
+
+/* Background I/O thread of a session: it runs advance() and owns
+ * the session timer, and the solver thread only exchanges
+ * ControlBuffers with it. */
+struct io_thread {
+	pthread_t thread;
+	/* Solver to I/O thread: full MEAS buffers. */
+	SPSC meas_queue;
+	/* I/O thread to solver: received CMDS buffers. */
+	SPSC cmds_queue;
+	/* Solver side: MEAS buffers the queue had no room for. */
+	FIFO meas_backlog;
+	/* Solver side: latest CMDS buffer. */
+	ControlBuffer cmds;
+	int stop;
+	int closed;
+};
+
+/* Queue length, in hours. */
+#define IO_QUEUE_SIZE		1024
+/* The I/O thread checks its queue at least this often. */
+#define IO_WAIT_MILLIS		10
+/* Sleep of an idle I/O thread, waiting for the solver. */
+#define IO_IDLE_MICROS		100
+/* At exit, time left to the I/O thread to exchange the hours
+ * already produced. */
+#define IO_DRAIN_MILLIS		5000
+
+/* All the state of a single simulated house. */
+struct house_session {
+	int32_t current_hour;
+	CommsStatus communication_status;
+
+	ControlBuffer meas_buffer;
+	ControlBuffer cmds_buffer;
+	/* Recycled buffers: the exchange makes no heap allocation once
+	 * the pools hold as many buffers as the hours in flight. */
+	CBPool meas_pool;
+	CBPool cmds_pool;
+
+	Timer comms_timer;
+	/* Model time per hour, and steps per hour. */
+	double period;
+	int steps;
+
+	FIFO out_meas_buffer;
+	/* MEAS buffers sent but not acknowledged by CMDS yet, replayed
+	 * to the next controller if this one leaves. */
+	FIFO sent_meas_buffer;
+	/* Hours out_meas_buffer dropped, already counted as exchanged. */
+	unsigned long dropped_hours;
+
+	/* Measures and commands, and the measures still due in the
+	 * hour being filled. */
+	Schema schema;
+	int meas_due;
+	/* Control of the last hour queued, whose late measures that
+	 * are not due are ignored. */
+	int32_t meas_queued;
+
+	struct socket_singleton *sockets;
+	/* Shared memory segment of the sockets, NULL over TCP. */
+	ShmSegment shm;
+	/* House of the multi-house server, -1 for a standalone one. */
+	int house;
+	const struct server_config *config;
+	/* Non-zero if a new controller can be accepted mid-run. */
+	int resumable;
+	/* Non-zero once the connections of a lost controller have been
+	 * closed, while waiting for a new one. */
+	int reconnecting;
+
+	/* Hours asked by the last CONTROL_BATCH request, 0 for a
+	 * legacy single hour request. */
+	int32_t batch_request;
+	/* Hours carried by the last MEAS frame. */
+	int32_t batch_size;
+	/* MEAS frame, allocated by the first hour sent and grown to
+	 * the largest batch asked for: a legacy controller never costs
+	 * the room of a full batch. */
+	char *batch_frame;
+	/* Most hours in a MEAS frame, bytes per hour in it, most bytes
+	 * per hour when compressed, and room in batch_frame for the
+	 * hours after the count. */
+	int32_t batch_max;
+	size_t hour_size;
+	size_t hour_room;
+	size_t batch_room;
+	/* Framed CMDS payload, or legacy CMDS values. */
+	char *cmds_frame;
+	size_t cmds_size;
+
+	/* Version and capabilities agreed with the controller,
+	 * all zero for a legacy controller. */
+	struct wire_hello wire;
+	/* MEAS stream codec, created by the first handshake agreeing
+	 * on WIRE_CAP_XOR and reset by the following ones. */
+	Gorilla gorilla;
+
+	/* Non-NULL when the io_uring backend carries the TCP I/O. */
+	Uring uring;
+	/* Non-NULL when a background thread runs advance(). */
+	struct io_thread *io;
+
+	/* Controller latency, from MEAS frame to CMDS buffer. */
+	unsigned long long meas_sent_at;
+	unsigned long long rtt_micros;
+
+	/* Per state of advance(), in microseconds: time blocked on
+	 * the controller, time left before the step deadline once it
+	 * answered, and delay past the first deadline it missed.
+	 * Created by the first wait in that state. */
+	Histogram wait_hist[COMMS_NUMBER];
+	Histogram slack_hist[COMMS_NUMBER];
+	Histogram overrun_hist[COMMS_NUMBER];
+	unsigned long long missed_at[COMMS_NUMBER];
+	unsigned long misses[COMMS_NUMBER];
+	/* SIGUSR1 count when the statistics were last dumped. */
+	sig_atomic_t stats_seen;
+};
+
+/* A standalone server, for a single house on sockets of its own:
+ * the one of startServers, or one per startServersContext. */
+struct house_context {
+	struct house_session session;
+	struct socket_singleton sockets[SOCKET_NUMBER];
+	struct server_config config;
+	/* Serializes the solver threads sharing the context. */
+	pthread_mutex_t lock;
+};
+
+/* A batched MEAS frame is an int32_t hour count followed,
+ * for each hour, by its control and its measures due in that
+ * hour, all of them unless the schema is multi-rate. Room for a
+ * wire header is reserved in front of it. A framed CMDS payload
+ * is the control followed by the commands. Both layouts come
+ * from the schema, see Schema.h. */
+
 /************************************************************
 * Local functions declaration
 ************************************************************/
 
-static void send_meas(const char * const name, const double value, const int32_t ctrl);
-static double get_cmds(const char * const name, const int32_t ctrl);
-
-static void advance(const int32_t ctrl, const int step);
-static int recv_MEAS_ctrl(CommsStatus *status, Timer t, const int step);
-static int send_MEAS_buffer(CommsStatus *status, const int step);
-static int recv_CMDS_ctrl(CommsStatus *status, Timer t, const int step);
-static int recv_CMDS_buffer(CommsStatus *status, Timer t, const int step);
-
-static int server_is_running(void);
-
-static void print_MEAS_buffer(void);
-static void print_CMDS_buffer(void);
+static void session_init(struct house_session *s, const double t, const unsigned long queries_per_int, const unsigned long speed);
+static struct house_session *get_session(const int house, const char * const fname);
+static int session_step(const struct house_session *s, const double t);
+
+static void send_meas(struct house_session *s, const int index, const double value, const int32_t ctrl, const int step);
+static void queue_meas(struct house_session *s, ControlBuffer meas, const int32_t ctrl, const int step);
+static int insert_meas(struct house_session *s, ControlBuffer meas);
+static void release_meas(void *meas);
+static size_t meas_toFrame(struct house_session *s, ControlBuffer meas, char * const frame);
+static void meas_toStream(struct house_session *s, ControlBuffer meas, struct gorilla_stream *stream);
+static double get_cmds(ControlBuffer cmds, const int index, const int32_t ctrl);
+static void load_schema(void);
+static int check_MEAS_handle(const struct house_session *s, const int handle, const char * const fname);
+static int check_CMDS_handle(const struct house_session *s, const int handle, const char * const fname);
+static int session_find(const struct house_session *s, const SchemaKinds kind, const char * const name,
+	const char * const fname);
+
+static void advance(struct house_session *s, const int32_t ctrl, const int step);
+static int session_reconnect(struct house_session *s, const int step);
+static void session_resume(struct house_session *s);
+static int recv_MEAS_ctrl(struct house_session *s, const int step);
+static int send_MEAS_buffer(struct house_session *s, const int step);
+static int send_MEAS_batch(struct house_session *s, const int step);
+static int32_t batch_limit(struct house_session *s);
+static int is_framed(struct house_session *s);
+static int is_compressed(struct house_session *s);
+static void set_speed(struct house_session *s, const uint32_t speed);
+static int recv_CMDS_ctrl(struct house_session *s, const int step);
+static int recv_CMDS_buffer(struct house_session *s, const int step);
+static int session_read_possible(struct house_session *s, const Sockets socket, const int step);
+static int session_wait(struct house_session *s, const Sockets socket, const int step);
+static void session_record_wait(struct house_session *s, const int step, const unsigned long long start, const int ready);
+static int session_timeout(struct house_session *s, const int step);
+static void send_MEAS_frame(struct house_session *s, const int step, const char * const buf, const size_t count);
+static char *session_frame(struct house_session *s, const int32_t hours);
+
+static void start_context(struct house_context *c, const double t, const unsigned long queries_per_int, const unsigned long speed);
+static void start_tcp(struct house_context *c, const double t);
+static int start_listening(struct house_context *c, const Sockets type, const int port);
+static void start_shm(struct house_context *c, const double t);
+static double context_send(struct house_context *c, const double val, const int handle, const double t, const int32_t ctrl, const char * const fname);
+static double context_get(struct house_context *c, const double val, const int handle, const double t, const int32_t ctrl, const char * const fname);
+static void open_log(void);
+static void open_log_once(void);
+static void session_destroy(struct house_session *s);
+static void session_detach_shm(struct house_session *s);
+
+static void io_thread_start(struct house_session *s);
+static void io_thread_stop(struct house_session *s);
+static void local_context_stop(void);
+static void *io_thread_run(void *arg);
+static void io_queue_meas(struct house_session *s, ControlBuffer meas);
+static void io_push_cmds(struct house_session *s);
+static void io_pull_cmds(struct house_session *s);
+
+static int server_is_running(struct house_session *s);
+static int session_connected(struct house_session *s);
+static void print_session_stats(struct house_session *s, const char * const name);
+static void session_name(const struct house_session *s, char *name, const size_t size);
+static void print_session_histograms(struct house_session *s, const char * const name);
+static void stats_signal_install(void);
+static void stats_signal_handler(int sig);
+
+static void print_MEAS_buffer(struct house_session *s);
+static void print_CMDS_buffer(struct house_session *s);
 
 /************************************************************
 * Local variables
 ************************************************************/
 
-static int32_t current_hour;
-static CommsStatus communication_status;
+/* Context used by startServers/sendOM/getOM. */
+static struct house_context local_context = {
+	.session = { .sockets = local_context.sockets, .house = -1, .config = &local_context.config },
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
 
-static ControlBuffer meas_buffer;
-static ControlBuffer cmds_buffer;
+/* Sessions used by startHouseServer/sendOMHouse/getOMHouse. */
+static HouseServer house_server;
+static struct house_session *house_sessions;
+static struct server_config house_config;
 
-static Timer comms_timer;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
 
-static FIFO out_meas_buffer;
-
-static struct socket_singleton sockets[SOCKET_NUMBER] = {{0}};
+/* Counts SIGUSR1: each session dumps its statistics at its next
+ * exchange after one. */
+static volatile sig_atomic_t stats_requested;
 
 /************************************************************
 * Function definition
 ************************************************************/
 
 /**
- * Listens on MEAS and CMDS ports and accepts a connection on each one.
+ * Waits for the controller on the transport selected by the
+ * HOUSE_TRANSPORT environment variable (MEAS and CMDS ports by
+ * default, a shared memory segment otherwise).
  */
 void startServers(const double t, const unsigned long queries_per_int, const unsigned long speed)
 {
-	if(server_is_running()) {
+	config_load(&local_context.config);
+	start_context(&local_context, t, queries_per_int, speed);
+
+	atexit(local_context_stop);
+}
+
+/**
+ * startServers, listening on [meas_port] and [cmds_port] whatever
+ * the environment says. Ports 0 are picked by the system, and
+ * published to HOUSE_PORT_FILE.
+ */
+void startServersOnPorts(const double t, const unsigned long queries_per_int, const unsigned long speed,
+	const int meas_port, const int cmds_port)
+{
+	config_load(&local_context.config);
+	config_setPorts(&local_context.config, meas_port, cmds_port);
+	start_context(&local_context, t, queries_per_int, speed);
+
+	atexit(local_context_stop);
+}
+
+/**
+ * Starts a server of its own for one more simulation in this
+ * process, listening on [meas_port] and [cmds_port] (0 to let the
+ * system pick them, see getContextPort). Its house is driven
+ * through sendOM_c and getOM_c, which may be called from any
+ * thread. Only TRANSPORT_TCP is supported.
+ * Returns the context, to be passed to every call. Suitable as the
+ * constructor of a Modelica ExternalObject.
+ */
+void *startServersContext(const double t, const unsigned long sec_per_step, const unsigned long sec_per_time_int,
+	const int meas_port, const int cmds_port)
+{
+	struct house_context *c = calloc(1, sizeof(*c));
+
+	if (NULL == c) {
+		ERROR("startServersContext: unable to allocate context.\n");
+	}
+	c->session.sockets = c->sockets;
+	c->session.house = -1;
+	c->session.config = &c->config;
+	if (pthread_mutex_init(&c->lock, NULL)) {
+		ERROR("startServersContext: unable to create lock.\n");
+	}
+
+	config_load(&c->config);
+	config_setPorts(&c->config, meas_port, cmds_port);
+	if (TRANSPORT_TCP != c->config.transport) {
+		ERROR("startServersContext: only the TCP transport supports contexts.\n");
+	}
+	/* Sockets inherited from the launcher belong to startServers. */
+	c->config.listen_fds[SOCKET_MEAS] = c->config.listen_fds[SOCKET_CMDS] = -1;
+
+	start_context(c, t, sec_per_step, sec_per_time_int);
+
+	return c;
+}
+
+/**
+ * Stops the server of context [ctx], after printing its statistics,
+ * and frees it. Suitable as the destructor of a Modelica
+ * ExternalObject.
+ */
+void stopServersContext(void *ctx)
+{
+	struct house_context *c = ctx;
+	Sockets type;
+	char name[32];
+
+	if (NULL == c) {
+		return;
+	}
+
+	io_thread_stop(&c->session);
+	session_name(&c->session, name, sizeof(name));
+	print_session_stats(&c->session, name);
+
+	for (type = 0; type < SOCKET_NUMBER; ++type) {
+		socket_close(&c->sockets[type]);
+		socket_release(&c->sockets[type]);
+		if (0 <= c->sockets[type].listen_fd) {
+			close(c->sockets[type].listen_fd);
+		}
+	}
+	session_detach_shm(&c->session);
+	session_destroy(&c->session);
+	pthread_mutex_destroy(&c->lock);
+	free(c);
+}
+
+/**
+ * Returns the port context [ctx] listens on for [socket], 0 for
+ * MEAS and 1 for CMDS.
+ */
+int getContextPort(void *ctx, const int socket)
+{
+	struct house_context *c = ctx;
+
+	if ((NULL == c) || (0 > socket) || (SOCKET_NUMBER <= socket)) {
+		ERROR("getContextPort: invalid argument.\n");
+	}
+	return socketPort(c->sockets[socket].listen_fd);
+}
+
+/**
+ * sendOM_h for the house of context [ctx].
+ */
+double sendOM_c(void *ctx, const double val, const int handle, const double t, const int32_t ctrl)
+{
+	struct house_context *c = ctx;
+	double ret;
+
+	if (NULL == c) {
+		ERROR("sendOM_c: NULL pointer argument.\n");
+	}
+
+	pthread_mutex_lock(&c->lock);
+	ret = context_send(c, val, handle, t, ctrl, "sendOM_c");
+	pthread_mutex_unlock(&c->lock);
+
+	return ret;
+}
+
+/**
+ * getOM_h for the house of context [ctx].
+ */
+double getOM_c(void *ctx, const double val, const int handle, const double t, const int32_t ctrl)
+{
+	struct house_context *c = ctx;
+	double ret;
+
+	if (NULL == c) {
+		ERROR("getOM_c: NULL pointer argument.\n");
+	}
+
+	pthread_mutex_lock(&c->lock);
+	ret = context_get(c, val, handle, t, ctrl, "getOM_c");
+	pthread_mutex_unlock(&c->lock);
+
+	return ret;
+}
+
+static void start_context(struct house_context *c, const double t, const unsigned long queries_per_int, const unsigned long speed)
+{
+	if(server_is_running(&c->session)) {
 		ERROR("startServers: connections already started.\n");
 	}
 
+	open_log();
+
+	if (house_loadSchema(c->config.schema_path)) {
+		ERROR("startServers: unable to use schema \"%s\".\n", c->config.schema_path);
+	}
+
+	switch (c->config.transport) {
+	case TRANSPORT_TCP:
+		start_tcp(c, t);
+		break;
+	case TRANSPORT_SHM:
+		start_shm(c, t);
+		break;
+	default:
+		ERROR("startServers: transport %d is invalid.\n", c->config.transport);
+	}
+
+	session_init(&c->session, t, queries_per_int, speed);
+
+	if (&local_context == c) {
+		atexit(printCommsStats);
+	}
+	stats_signal_install();
+
+	if (c->config.io_thread && timer_isLockstep(c->session.comms_timer)) {
+		WARNING("startServers: no I/O thread in lockstep mode.\n");
+	}
+	else if (c->config.io_thread) {
+		io_thread_start(&c->session);
+	}
+}
+
+/**
+ * Opens the log once per process, whatever the number of servers.
+ */
+static void open_log(void)
+{
+	pthread_once(&log_once, open_log_once);
+}
+
+static void open_log_once(void)
+{
 	OPEN_DEBUG("houseServer");
+}
+
+/**
+ * sendOM_h for the house of context [c], on behalf of [fname].
+ */
+static double context_send(struct house_context *c, const double val, const int handle, const double t, const int32_t ctrl, const char * const fname)
+{
+	struct house_session *s = &c->session;
+
+	if(!server_is_running(s)) {
+		WARNING("%s: server not started or connection closed.\n", fname);
+		return 0.0;
+	}
+
+	int index = check_MEAS_handle(s, handle, fname);
+	int step = session_step(s, t);
+
+	send_meas(s, index, val, ctrl, step);
+	if (NULL != s->io) {
+		return val;
+	}
+	advance(s, ctrl, step);
+
+	return val;
+}
+
+/**
+ * getOM_h for the house of context [c], on behalf of [fname].
+ */
+static double context_get(struct house_context *c, const double val, const int handle, const double t, const int32_t ctrl, const char * const fname)
+{
+	struct house_session *s = &c->session;
+
+	if(!server_is_running(s)) {
+		WARNING("%s: server not started or connection closed.\n", fname);
+		return 0.0;
+	}
+
+	int index = check_CMDS_handle(s, handle, fname);
+	int step = session_step(s, t);
+
+	if (NULL != s->io) {
+		io_queue_meas(s, NULL);
+		io_pull_cmds(s);
+		return get_cmds(s->io->cmds, index, ctrl);
+	}
+
+	advance(s, ctrl, step);
+
+	return get_cmds(s->cmds_buffer, index, ctrl);
+}
+
+/**
+ * Returns the handle of the MEAS [name], for sendOM_h and
+ * sendOMHouse_h. Throws an error if there is no such MEAS.
+ */
+int getMEASHandle(const char * const name)
+{
+	if(NULL == name) {
+		ERROR("getMEASHandle: NULL pointer argument.\n");
+	}
+
+	load_schema();
+	int index = get_MEAS_num_from_name(name);
+	if(0 > index) {
+		ERROR("getMEASHandle: unkwon name \"%s\".\n", name);
+	}
+
+	return index;
+}
+
+/**
+ * Returns the handle of the CMDS [name], for getOM_h and
+ * getOMHouse_h. Throws an error if there is no such CMDS.
+ */
+int getCMDSHandle(const char * const name)
+{
+	if(NULL == name) {
+		ERROR("getCMDSHandle: NULL pointer argument.\n");
+	}
+
+	load_schema();
+	int index = get_CMDS_num_from_name(name);
+	if(0 > index) {
+		ERROR("getCMDSHandle: unkwon name \"%s\".\n", name);
+	}
 
+	return index;
+}
+
+/**
+ * Buffers the [val] in the [name] slot. Sends all values if the MEAS
+ * buffer is full. Throws econnectrror if [name] variable has already been
+ * buffered.
+ */
+double sendOM(const double val, const char * const name, const double t, const int32_t ctrl)
+{
+	if(NULL == name) {
+		ERROR("sendOM: NULL pointer argument.\n");
+	}
+
+	return sendOM_h(val, session_find(&local_context.session, SCHEMA_MEAS, name, "sendOM"), t, ctrl);
+}
+
+/**
+ * sendOM for the MEAS of [handle], as returned by getMEASHandle.
+ */
+double sendOM_h(const double val, const int handle, const double t, const int32_t ctrl)
+{
+	return context_send(&local_context, val, handle, t, ctrl, "sendOM_h");
+}
+
+/**
+ * Returns the [name] variable received from CMDS socket. If the
+ * [name] variable has already been taken, throws an error. If the
+ * CMDS buffer is empty, loads data from the socket.
+ */
+double getOM(const double val, const char * const name, const double t, const int32_t ctrl)
+{
+	if(NULL == name) {
+		ERROR("getOM: NULL pointer argument.\n");
+	}
+
+	return getOM_h(val, session_find(&local_context.session, SCHEMA_CMDS, name, "getOM"), t, ctrl);
+}
+
+/**
+ * getOM for the CMDS of [handle], as returned by getCMDSHandle.
+ */
+double getOM_h(const double val, const int handle, const double t, const int32_t ctrl)
+{
+	return context_get(&local_context, val, handle, t, ctrl, "getOM_h");
+}
+
+/************************************************************
+* Multi-house server functions
+************************************************************/
+
+/**
+ * Listens on MEAS and CMDS ports on behalf of [houses] houses,
+ * without waiting for any connection. Controllers identify the
+ * house they drive by sending its ID as first message on each
+ * connection; houses are then served through sendOMHouse and
+ * getOMHouse.
+ */
+void startHouseServer(const double t, const unsigned long queries_per_int, const unsigned long speed, const int houses)
+{
+	if(NULL != house_server) {
+		ERROR("startHouseServer: server already started.\n");
+	}
+
+	open_log();
+
+	config_load(&house_config);
+	if (house_loadSchema(house_config.schema_path)) {
+		ERROR("startHouseServer: unable to use schema \"%s\".\n", house_config.schema_path);
+	}
+
+	house_server = HS_create(house_config.meas_port, house_config.cmds_port, houses);
+	if (NULL == house_server) {
+		ERROR("startHouseServer: unable to create server for %d houses.\n", houses);
+	}
+	config_publishPorts(&house_config, HS_getPort(house_server, SOCKET_MEAS), HS_getPort(house_server, SOCKET_CMDS));
+
+	house_sessions = calloc(houses, sizeof(*house_sessions));
+	if (NULL == house_sessions) {
+		ERROR("startHouseServer: unable to allocate %d sessions.\n", houses);
+	}
+
+	int i;
+	for (i = 0; i < houses; ++i) {
+		house_sessions[i].sockets = HS_getSockets(house_server, i);
+		house_sessions[i].house = i;
+		house_sessions[i].config = &house_config;
+		/* Houses wait for their first controller like for a new one. */
+		house_sessions[i].resumable = 1;
+		house_sessions[i].reconnecting = 1;
+		session_init(&house_sessions[i], t, queries_per_int, speed);
+	}
+
+	DEBUG_PRINT("startHouseServer: serving %d houses from simulation time %.2f.\n", houses, t);
+
+	atexit(printCommsStats);
+	stats_signal_install();
+}
+
+/**
+ * Prints the socket counters and wait histograms of every session,
+ * to verify how many syscalls each hour costs and how close the
+ * controller comes to the deadlines. Takes no lock: call it once
+ * the exchanges are over. SIGUSR1 has each session print its own
+ * statistics instead, from the thread running its exchanges.
+ */
+void printCommsStats(void)
+{
+	print_session_stats(&local_context.session, "local");
+
+	if (NULL == house_server) {
+		return;
+	}
+
+	int i;
+	char name[32];
+
+	for (i = 0; i < HS_getHouses(house_server); ++i) {
+		snprintf(name, sizeof(name), "house %d", i);
+		print_session_stats(&house_sessions[i], name);
+	}
+}
+
+/**
+ * sendOM for house [house] of the multi-house server.
+ */
+double sendOMHouse(const int house, const double val, const char * const name, const double t, const int32_t ctrl)
+{
+	if(NULL == name) {
+		ERROR("sendOMHouse: NULL pointer argument.\n");
+	}
+
+	return sendOMHouse_h(house, val,
+		session_find(get_session(house, "sendOMHouse"), SCHEMA_MEAS, name, "sendOMHouse"), t, ctrl);
+}
+
+/**
+ * sendOM_h for house [house] of the multi-house server.
+ */
+double sendOMHouse_h(const int house, const double val, const int handle, const double t, const int32_t ctrl)
+{
+	struct house_session *s = get_session(house, "sendOMHouse_h");
+	int index = check_MEAS_handle(s, handle, "sendOMHouse_h");
+
+	int step = session_step(s, t);
+
+	send_meas(s, index, val, ctrl, step);
+	advance(s, ctrl, step);
+
+	return val;
+}
+
+/**
+ * getOM for house [house] of the multi-house server.
+ */
+double getOMHouse(const int house, const double val, const char * const name, const double t, const int32_t ctrl)
+{
+	if(NULL == name) {
+		ERROR("getOMHouse: NULL pointer argument.\n");
+	}
+
+	return getOMHouse_h(house, val,
+		session_find(get_session(house, "getOMHouse"), SCHEMA_CMDS, name, "getOMHouse"), t, ctrl);
+}
+
+/**
+ * getOM_h for house [house] of the multi-house server.
+ */
+double getOMHouse_h(const int house, const double val, const int handle, const double t, const int32_t ctrl)
+{
+	struct house_session *s = get_session(house, "getOMHouse_h");
+	int index = check_CMDS_handle(s, handle, "getOMHouse_h");
+
+	int step = session_step(s, t);
+
+	advance(s, ctrl, step);
+
+	return get_cmds(s->cmds_buffer, index, ctrl);
+}
+
+/************************************************************
+* Transport startup functions
+************************************************************/
+
+/**
+ * Listens on MEAS and CMDS ports, or on the sockets inherited from
+ * the launcher, and accepts a connection on each one. With
+ * HOUSE_LAZY_ACCEPT, returns right away: the first advance()
+ * accepts the controller, like one that reconnects.
+ */
+static void start_tcp(struct house_context *c, const double t)
+{
+	struct socket_singleton *sockets = c->sockets;
 	int fds_left = SOCKET_NUMBER;
 	struct pollfd fds[SOCKET_NUMBER] = {{0}};
 
 	/* Create sockets. */
-	if(0 > (sockets[SOCKET_CMDS].listen_fd = socketBuilder(CMDS_LISTEN_PORT, 1))) {
-		ERROR("startServers: unable to create CMDS socket.\n");
-	}
+	sockets[SOCKET_CMDS].listen_fd = start_listening(c, SOCKET_CMDS, c->config.cmds_port);
+	sockets[SOCKET_MEAS].listen_fd = start_listening(c, SOCKET_MEAS, c->config.meas_port);
 
-	if(0 > (sockets[SOCKET_MEAS].listen_fd = socketBuilder(MEAS_LISTEN_PORT, 1))) {
-		ERROR("startServers: unable to create MEAS socket.\n");
-	}
+	config_publishPorts(&c->config, socketPort(sockets[SOCKET_MEAS].listen_fd), socketPort(sockets[SOCKET_CMDS].listen_fd));
+	DEBUG_PRINT("startServers: listening on ports %d/%d.\n",
+		socketPort(sockets[SOCKET_MEAS].listen_fd), socketPort(sockets[SOCKET_CMDS].listen_fd));
 
 	/* Wait until both (all) connections are accepted. */
-	do {
+	while ((!c->config.lazy_accept) && (0 < fds_left)) {
 		buildPoll(fds, fds_left, sockets);
 
 		if(0 < poll(fds, fds_left, -1)) {
@@ -101,250 +777,1102 @@ void startServers(const double t, const unsigned long queries_per_int, const uns
 		else { /* Poll failure. */
 			ERROR("startServers: poll failure.\n");
 		}
+	}
+
+	c->session.resumable = 1;
+	c->session.reconnecting = (0 < fds_left);
+
+	if (IO_BACKEND_URING == c->config.io_backend) {
+		c->session.uring = uring_create();
+		if (NULL == c->session.uring) {
+			WARNING("startServers: io_uring unavailable, falling back to poll.\n");
+		}
+	}
+
+	if (0 < fds_left) {
+		DEBUG_PRINT("startServers: controller will be accepted lazily, from simulation time %.2f.\n", t);
+		return;
+	}
+	DEBUG_PRINT("startServers: all connection accepted at simulation time %.2f.\n", t);
+}
+
+/**
+ * Returns the listening socket for [type]: the one inherited from
+ * the launcher if any, a new one on [port] otherwise.
+ */
+static int start_listening(struct house_context *c, const Sockets type, const int port)
+{
+	int fd;
+
+	if (0 <= c->config.listen_fds[type]) {
+		if (0 > (fd = socketAdopt(c->config.listen_fds[type]))) {
+			ERROR("startServers: inherited fd %d is not a listening socket.\n", c->config.listen_fds[type]);
+		}
+		return fd;
+	}
+	if (0 > (fd = socketBuilder(port, 1))) {
+		ERROR("startServers: unable to create %s socket on port %d.\n", (SOCKET_MEAS == type) ? "MEAS" : "CMDS", port);
+	}
+	return fd;
+}
+
+/**
+ * Creates the shared memory segment and waits for the controller
+ * to attach to it.
+ */
+static void start_shm(struct house_context *c, const double t)
+{
+	Sockets type;
+
+	c->session.shm = SHM_create(c->config.shm_path);
+	if (NULL == c->session.shm) {
+		ERROR("startServers: unable to create shared memory segment \"%s\".\n", c->config.shm_path);
+	}
+	if (SHM_waitPeer(c->session.shm, -1)) {
+		ERROR("startServers: controller never attached.\n");
+	}
+
+	for (type = 0; type < SOCKET_NUMBER; ++type) {
+		c->sockets[type].shm = SHM_getChannel(c->session.shm, type);
+		c->sockets[type].started = 1;
+	}
+	c->session.resumable = 1;
+
+	DEBUG_PRINT("startServers: controller attached to \"%s\" at simulation time %.2f.\n", c->config.shm_path, t);
+}
+
+/************************************************************
+* Session functions
+************************************************************/
+
+/**
+ * Creates timer, FIFO and buffers of session [s].
+ */
+static void session_init(struct house_session *s, const double t, const unsigned long queries_per_int, const unsigned long speed)
+{
+	/* Initialize timer */
+	s->comms_timer = create_timer(speed, queries_per_int);
+	if (NULL == s->comms_timer) {
+		ERROR("session_init: unable to create timer.\n");
+	}
+	if (s->config->timer_fd && timer_enableFd(s->comms_timer)) {
+		WARNING("session_init: timerfd unavailable, using poll timeouts.\n");
+	}
+	if (s->config->adaptive_speed && timer_setAdaptive(s->comms_timer, s->config->speed_slack)) {
+		ERROR("session_init: unable to set adaptive speed.\n");
+	}
+	if (timer_setWait(s->comms_timer, s->config->wait, s->config->spin_micros)) {
+		ERROR("session_init: unable to set wait strategy.\n");
+	}
+	if (timer_setPeriod(s->comms_timer, s->config->interval)) {
+		ERROR("session_init: unable to set communication interval.\n");
+	}
+	s->period = (double) s->config->interval / s->config->time_unit;
+	s->steps = queries_per_int;
+
+	/* Initialize MEAS buffer FIFOs */
+	s->out_meas_buffer = fifo_initBounded(s->config->fifo_capacity, s->config->fifo_policy, release_meas);
+	s->sent_meas_buffer = fifo_init();
+	if ((NULL == s->out_meas_buffer) || (NULL == s->sent_meas_buffer)) {
+		ERROR("session_init: unable to create FIFO.\n");
+	}
+
+	/* Initialize buffers, sized by the schema */
+	Schema schema = s->schema = house_getSchema();
+	s->meas_pool = CB_initPool(schema_count(schema, SCHEMA_MEAS));
+	s->cmds_pool = CB_initPool(schema_count(schema, SCHEMA_CMDS));
+	if ((NULL == s->meas_pool) || (NULL == s->cmds_pool)) {
+		ERROR("session_init: unable to create control buffer pools.\n");
+	}
+	s->meas_buffer = CB_get(s->meas_pool);
+	if (NULL == s->meas_buffer) {
+		ERROR("session_init: unable to create MEAS control buffer.\n");
+	}
+	s->cmds_buffer = CB_get(s->cmds_pool);
+	if (NULL == s->cmds_buffer) {
+		ERROR("session_init: unable to create CMDS control buffer.\n");
+	}
+
+	/* Batches stay within the largest frame controllers accept,
+	 * even when compression makes the hours longer. */
+	s->hour_size = schema_frameSize(schema, SCHEMA_MEAS);
+	s->hour_room = gorilla_maxSize(schema_count(schema, SCHEMA_MEAS));
+	if (s->hour_size > s->hour_room) {
+		s->hour_room = s->hour_size;
+	}
+	s->batch_max = (WIRE_MAX_PAYLOAD - sizeof(int32_t)) / s->hour_room;
+	if (BATCH_MAX_HOURS < s->batch_max) {
+		s->batch_max = BATCH_MAX_HOURS;
+	}
+	s->cmds_size = schema_frameSize(schema, SCHEMA_CMDS);
+	s->cmds_frame = malloc(s->cmds_size);
+	if (NULL == s->cmds_frame) {
+		ERROR("session_init: unable to create CMDS frame.\n");
+	}
+	s->batch_request = 0;
+	s->batch_size = 1;
+	memset(&s->wire, 0, sizeof(s->wire));
+
+	s->current_hour = 1;
+	if (CB_setControl(s->meas_buffer, &s->current_hour)) {
+		ERROR("session_init: unable to set MEAS control.\n");
+	}
+	s->meas_due = schema_dueCount(schema, s->current_hour);
+	s->meas_queued = 0;
+	if (CB_setControl(s->cmds_buffer, &s->current_hour)) {
+		ERROR("session_init: unable to set CMDS contro.\n");
+	}
+
+	s->communication_status = COMMS_MEAS_WAIT;
+	s->stats_seen = stats_requested;
+}
+
+/**
+ * Detaches session [s] from its shared memory segment, if any,
+ * which removes the segment: a controller still attached sees the
+ * server leave.
+ */
+static void session_detach_shm(struct house_session *s)
+{
+	Sockets type;
+
+	if (NULL == s->shm) {
+		return;
+	}
+	for (type = 0; type < SOCKET_NUMBER; ++type) {
+		socket_close(&s->sockets[type]);
+		s->sockets[type].shm = NULL;
+	}
+	SHM_detach(s->shm);
+	s->shm = NULL;
+}
+
+/**
+ * Frees what session [s] holds, once its I/O thread, if any, has
+ * stopped.
+ */
+static void session_destroy(struct house_session *s)
+{
+	ControlBuffer b;
+	CommsStatus status;
+
+	if (NULL != s->io) {
+		while (NULL != (b = spsc_pop(s->io->meas_queue))) {
+			CB_release(b);
+		}
+		while (NULL != (b = spsc_pop(s->io->cmds_queue))) {
+			CB_release(b);
+		}
+		while (NULL != (b = fifo_pop(s->io->meas_backlog))) {
+			CB_release(b);
+		}
+		CB_release(s->io->cmds);
+		spsc_destroy(s->io->meas_queue);
+		spsc_destroy(s->io->cmds_queue);
+		fifo_destroy(s->io->meas_backlog);
+		free(s->io);
+		s->io = NULL;
+	}
+
+	while (NULL != (b = fifo_pop(s->out_meas_buffer))) {
+		CB_release(b);
+	}
+	while (NULL != (b = fifo_pop(s->sent_meas_buffer))) {
+		CB_release(b);
+	}
+	fifo_destroy(s->out_meas_buffer);
+	fifo_destroy(s->sent_meas_buffer);
+
+	CB_release(s->meas_buffer);
+	CB_release(s->cmds_buffer);
+	CB_destroyPool(s->meas_pool);
+	CB_destroyPool(s->cmds_pool);
+
+	destroy_timer(s->comms_timer);
+	if (NULL != s->uring) {
+		uring_destroy(s->uring);
+	}
+	free(s->batch_frame);
+	free(s->cmds_frame);
+	gorilla_destroy(s->gorilla);
+
+	for (status = 0; status < COMMS_NUMBER; ++status) {
+		hist_destroy(s->wait_hist[status]);
+		hist_destroy(s->slack_hist[status]);
+		hist_destroy(s->overrun_hist[status]);
+	}
+}
+
+/**
+ * Returns the multi-house server session of [house].
+ */
+static struct house_session *get_session(const int house, const char * const fname)
+{
+	if (NULL == house_server) {
+		ERROR("%s: multi-house server not started.\n", fname);
+	}
+	if ((0 > house) || (HS_getHouses(house_server) <= house)) {
+		ERROR("%s: invalid house %d.\n", fname, house);
+	}
+	return &house_sessions[house];
+}
+
+/**
+ * Returns the step of the hour [t] falls in, for session [s].
+ */
+static int session_step(const struct house_session *s, const double t)
+{
+	int step = (int) (fmod(t, s->period) * s->steps / s->period);
+
+	return (s->steps <= step) ? s->steps - 1 : step;
+}
+
+/************************************************************
+* Communication functions
+************************************************************/
+
+static void advance(struct house_session *s, const int32_t ctrl, const int step)
+{
+	char name[32];
+
+	if (s->stats_seen != stats_requested) {
+		s->stats_seen = stats_requested;
+		session_name(s, name, sizeof(name));
+		print_session_stats(s, name);
+	}
+
+	while (s->current_hour <= ctrl) {
+		if ((!session_connected(s)) && session_reconnect(s, step)) {
+			return;
+		}
+
+		switch(s->communication_status) {
+		case COMMS_MEAS_WAIT:
+			if (recv_MEAS_ctrl(s, step)) {
+				return;
+			}
+			break;
+
+		case COMMS_MEAS_SEND:
+			if (send_MEAS_buffer(s, step)) {
+				return;
+			}
+			break;
+
+		case COMMS_CMDS_WAIT:
+			if (recv_CMDS_ctrl(s, step)) {
+				return;
+			}
+			break;
+
+		case COMMS_CMDS_RECV:
+			if (recv_CMDS_buffer(s, step)) {
+				return;
+			}
+			s->current_hour += s->batch_size;
+			break;
+
+		default:
+			ERROR("advance: status %d is invalid.\n", s->communication_status);
+
+		} /* Switch */
+	} /* While */
+}
+
+/**
+ * Waits until the end of [step] for a controller to replace the
+ * one that left session [s] (or, for a house of the multi-house
+ * server, for its first one). Returns 0 once both connections are
+ * accepted, non-zero otherwise.
+ */
+static int session_reconnect(struct house_session *s, const int step)
+{
+	struct pollfd fds[SOCKET_NUMBER] = {{0}};
+	int fds_left = 0;
+	Sockets type;
+
+	if (!s->resumable) {
+		return 1;
+	}
+
+	/* Drop what is left of the previous controller. */
+	if (!s->reconnecting) {
+		WARNING("advance: controller left at hour %d, waiting for a new one.\n", s->current_hour);
+		if (0 > s->house) {
+			for (type = 0; type < SOCKET_NUMBER; ++type) {
+				socket_close(&s->sockets[type]);
+			}
+			if (NULL != s->shm) {
+				SHM_reset(s->shm);
+			}
+		}
+		else {
+			HS_disconnect(house_server, s->house);
+		}
+		s->reconnecting = 1;
+	}
+
+	if (0 <= s->house) {
+		if (!HS_waitHouse(house_server, s->house, session_timeout(s, step))) {
+			return 1;
+		}
+	}
+	else if (NULL != s->shm) {
+		/* The channels stay, the new controller maps the same rings. */
+		if (SHM_waitPeer(s->shm, session_timeout(s, step))) {
+			return 1;
+		}
+		for (type = 0; type < SOCKET_NUMBER; ++type) {
+			s->sockets[type].started = 1;
+		}
+	}
+	else {
+		for (type = 0; type < SOCKET_NUMBER; ++type) {
+			fds_left += !s->sockets[type].started;
+		}
+		buildPoll(fds, fds_left, s->sockets);
+		if (0 >= poll(fds, fds_left, session_timeout(s, step))) {
+			return 1;
+		}
+		if (0 < acceptConnections(fds, fds_left, s->sockets)) {
+			return 1;
+		}
+		/* The new sockets may reuse the old descriptors. */
+		timer_forgetFds(s->comms_timer);
+	}
+
+	session_resume(s);
+
+	return 0;
+}
+
+/**
+ * Restarts the exchange with a new controller: the hours it missed
+ * go back in front of the FIFO, and the handshake starts over.
+ */
+static void session_resume(struct house_session *s)
+{
+	/* Unacknowledged hours first, then the ones never sent. */
+	if (fifo_requeue(s->out_meas_buffer, s->sent_meas_buffer)) {
+		ERROR("session_resume: unable to insert MEAS buffer in FIFO.\n");
+	}
+
+	s->communication_status = COMMS_MEAS_WAIT;
+	s->batch_request = 0;
+	s->batch_size = 1;
+	memset(&s->wire, 0, sizeof(s->wire));
+	s->reconnecting = 0;
+
+	if (1 < s->current_hour) {
+		WARNING("advance: controller reconnected, resuming from hour %d.\n", s->current_hour);
+	}
+}
+
+/**
+ * Returns the MEAS frame of session [s], with room for [hours]
+ * hours, growing it as needed.
+ */
+static char *session_frame(struct house_session *s, const int32_t hours)
+{
+	size_t room = hours * s->hour_room;
+	char *frame;
+
+	if (room <= s->batch_room) {
+		return s->batch_frame;
+	}
+	/* Double it, so that a growing batch reallocates only a few
+	 * times. */
+	if (room < 2 * s->batch_room) {
+		room = 2 * s->batch_room;
+	}
+	if (room > s->batch_max * s->hour_room) {
+		room = s->batch_max * s->hour_room;
+	}
+	frame = realloc(s->batch_frame, WIRE_HEADER_SIZE + sizeof(int32_t) + room);
+	if (NULL == frame) {
+		ERROR("session_frame: unable to create MEAS frame of %d hours.\n", hours);
+	}
+	s->batch_frame = frame;
+	s->batch_room = room;
+
+	return frame;
+}
+
+/**
+ * Returns non-zero if [socket] of session [s] can be read before
+ * the end of [step]. Multi-house sessions wait on the shared epoll
+ * instance, the local session polls its own socket or shared
+ * memory channel, or reads it through io_uring. Data already
+ * buffered in userspace is readable right away.
+ */
+static int session_read_possible(struct house_session *s, const Sockets socket, const int step)
+{
+	unsigned long long start = timer_now_nanos();
+	int ready = session_wait(s, socket, step);
+
+	session_record_wait(s, step, start, ready);
+
+	return ready;
+}
+
+static int session_wait(struct house_session *s, const Sockets socket, const int step)
+{
+	if (0 < socket_buffered(&s->sockets[socket])) {
+		return 1;
+	}
+	if (NULL != s->sockets[socket].shm) {
+		return SHM_wait(s->sockets[socket].shm, session_timeout(s, step));
+	}
+	if (NULL != s->uring) {
+		return uring_recv(s->uring, &s->sockets[socket], session_timeout(s, step));
+	}
+	if (NULL != s->io) {
+		return socket_wait(&s->sockets[socket], IO_WAIT_MILLIS);
+	}
+	if (0 > s->house) {
+		return read_possible(s->comms_timer, step, s->sockets[socket].accept_fd);
+	}
+	return HS_wait(house_server, &s->sockets[socket], session_timeout(s, step));
+}
+
+/**
+ * Accounts for a wait of session [s] started at [start], in the
+ * histograms of the current state. A wait that ends without data
+ * on a live connection missed the deadline of [step]; the overrun
+ * is recorded once the controller finally answers. The I/O thread
+ * only polls, it has no deadline to miss.
+ */
+static void session_record_wait(struct house_session *s, const int step, const unsigned long long start, const int ready)
+{
+	if (NULL != s->io) {
+		return;
+	}
+
+	CommsStatus status = s->communication_status;
+	unsigned long long now = timer_now_nanos();
+
+	if (NULL == s->wait_hist[status]) {
+		s->wait_hist[status] = hist_init();
+		s->slack_hist[status] = hist_init();
+		s->overrun_hist[status] = hist_init();
+		if ((NULL == s->wait_hist[status]) || (NULL == s->slack_hist[status]) || (NULL == s->overrun_hist[status])) {
+			ERROR("session_record_wait: unable to create histograms.\n");
+		}
+	}
+	hist_record(s->wait_hist[status], (now - start) / 1000ULL);
+
+	if (ready) {
+		if (0 != s->missed_at[status]) {
+			hist_record(s->overrun_hist[status], (now - s->missed_at[status]) / 1000ULL);
+			s->missed_at[status] = 0;
+		}
+		else if (!timer_isLockstep(s->comms_timer)) {
+			hist_record(s->slack_hist[status], timer_remaining_micros(s->comms_timer, step));
+		}
+	}
+	else if (session_connected(s)) {
+		++s->misses[status];
+		if (0 == s->missed_at[status]) {
+			s->missed_at[status] = now;
+		}
+	}
+}
+
+/**
+ * Returns how long session [s] may wait for the controller: until
+ * the end of [step], or only briefly on the I/O thread, which must
+ * keep draining the solver queue.
+ */
+static int session_timeout(struct house_session *s, const int step)
+{
+	if (NULL != s->io) {
+		return IO_WAIT_MILLIS;
+	}
+	return timer_timeout_millis(s->comms_timer, step);
+}
+
+static int recv_MEAS_ctrl(struct house_session *s, const int step)
+{
+	if (!session_read_possible(s, SOCKET_MEAS, step)) {
+		return 1;
+	}
+	int32_t control_in;
+	union {
+		struct wire_meas_request request;
+		struct wire_speed speed;
+	} frame;
+	WireTypes type;
+	int length;
+
+	s->batch_request = 0;
+
+	if (is_framed(s)) {
+		length = wire_recvAny(&s->sockets[SOCKET_MEAS], &type, &frame, sizeof(frame));
+		if (!s->sockets[SOCKET_MEAS].started) {
+			return 1;
+		}
+		if ((WIRE_SPEED == type) && (s->wire.caps & WIRE_CAP_SPEED) && (sizeof(frame.speed) == length)) {
+			set_speed(s, frame.speed.speed);
+			/* Still waiting for the MEAS request. */
+			return 0;
+		}
+		if ((WIRE_MEAS_REQUEST != type) || (sizeof(frame.request) != length)) {
+			/* Drop the controller as if it had left. */
+			WARNING("recv_MEAS_ctrl: invalid MEAS request frame, closing the connection.\n");
+			socket_close(&s->sockets[SOCKET_MEAS]);
+			return 1;
+		}
+		control_in = frame.request.control;
+		s->batch_request = (s->wire.caps & WIRE_CAP_BATCH) ? frame.request.max_hours : 1;
+	}
+	else {
+		recv_complete(&s->sockets[SOCKET_MEAS], (char*) &control_in, sizeof (int32_t));
+		if (!s->sockets[SOCKET_MEAS].started) {
+			return 1;
+		}
+
+		if (CONTROL_HELLO == control_in) {
+			if (wire_accept(&s->sockets[SOCKET_MEAS], &s->wire)) {
+				return 1;
+			}
+			if ((s->wire.caps & WIRE_CAP_XOR) && (NULL == s->gorilla)) {
+				s->gorilla = gorilla_init(schema_count(s->schema, SCHEMA_MEAS));
+				if (NULL == s->gorilla) {
+					ERROR("recv_MEAS_ctrl: unable to create MEAS codec.\n");
+				}
+			}
+			gorilla_reset(s->gorilla);
+			/* Still waiting for the first MEAS request. */
+			return 0;
+		}
+		if (CONTROL_BATCH == control_in) {
+			recv_complete(&s->sockets[SOCKET_MEAS], (char*) &s->batch_request, sizeof (int32_t));
+			if (!s->sockets[SOCKET_MEAS].started) {
+				return 1;
+			}
+		}
+	}
+
+	DEBUG_PRINT("recv_MEAS_ctrl: MEAS control message from server is \"%d\".\n", control_in);
+
+	if (0 != s->batch_request) {
+		if ((0 > s->batch_request) || (s->batch_max < s->batch_request)) {
+			s->batch_request = s->batch_max;
+		}
+		DEBUG_PRINT("recv_MEAS_ctrl: controller asked for up to %d hours.\n", s->batch_request);
+	}
+
+	s->communication_status = COMMS_MEAS_SEND;
+
+	return 0;
+}
+
+static int send_MEAS_buffer(struct house_session *s, const int step)
+{
+	if (NULL == fifo_peek(s->out_meas_buffer)) {
+		return 1;
+	}
+	if (0 < s->batch_request) {
+		return send_MEAS_batch(s, step);
+	}
+
+	ControlBuffer extracted_meas_buffer;
+	int32_t control_out;
+	size_t size;
+	char *frame = session_frame(s, 1) + WIRE_HEADER_SIZE;
+
+	extracted_meas_buffer = fifo_pop(s->out_meas_buffer);
+	/* Holds: extracted_meas_buffer  is not NULL ! */
+
+	size = meas_toFrame(s, extracted_meas_buffer, frame);
+	memcpy(&control_out, frame, sizeof(int32_t));
+	socket_write(&s->sockets[SOCKET_MEAS], frame, size);
+	s->meas_sent_at = timer_now_micros();
+	send_MEAS_frame(s, step, NULL, 0);
+	DEBUG_PRINT("advance: sent MEAS control message \"%d\" and MEAS buffer.\n", control_out);
+	if (fifo_insert(s->sent_meas_buffer, extracted_meas_buffer)) {
+		ERROR("advance: unable to keep MEAS buffer until acknowledged.\n");
+	}
+	s->batch_size = 1;
+	s->communication_status = COMMS_CMDS_WAIT;
+
+	return 0;
+}
+
+/**
+ * Drains up to batch_limit() hours from the FIFO into a single
+ * MEAS frame. The following CMDS exchange acknowledges all of them.
+ * This is also the only MEAS frame format of the framed protocol.
+ */
+static int send_MEAS_batch(struct house_session *s, const int step)
+{
+	ControlBuffer extracted_meas_buffer;
+	int32_t limit = batch_limit(s), count = 0;
+	char *frame = session_frame(s, limit) + WIRE_HEADER_SIZE;
+	char *p = frame + sizeof(int32_t);
+	struct gorilla_stream stream;
+	int compressed = is_compressed(s);
+
+	if (compressed) {
+		gorilla_open(&stream, p, s->batch_room);
+	}
+	while ((count < limit) && (NULL != (extracted_meas_buffer = fifo_pop(s->out_meas_buffer)))) {
+		if (compressed) {
+			meas_toStream(s, extracted_meas_buffer, &stream);
+		}
+		else {
+			p += meas_toFrame(s, extracted_meas_buffer, p);
+		}
+		if (fifo_insert(s->sent_meas_buffer, extracted_meas_buffer)) {
+			ERROR("advance: unable to keep MEAS buffer until acknowledged.\n");
+		}
+		++count;
+	}
+	if (compressed) {
+		p += gorilla_close(&stream);
+	}
+	memcpy(frame, &count, sizeof(int32_t));
+
+	if (is_framed(s)) {
+		wire_setHeader(s->batch_frame, WIRE_MEAS, p - frame);
+		frame = s->batch_frame;
+	}
+	s->meas_sent_at = timer_now_micros();
+	send_MEAS_frame(s, step, frame, p - frame);
+	DEBUG_PRINT("advance: sent MEAS batch of %d hours (limit %d).\n", count, limit);
+
+	s->batch_size = count;
+	s->communication_status = COMMS_CMDS_WAIT;
+
+	return 0;
+}
+
+/**
+ * Sends the MEAS frame gathered by socket_write, followed by
+ * [count] bytes of [buf]. With io_uring, the receive of the CMDS
+ * answer is chained behind the send, bounded by the end of [step].
+ */
+static void send_MEAS_frame(struct house_session *s, const int step, const char * const buf, const size_t count)
+{
+	if (NULL != s->uring) {
+		uring_flush(s->uring, &s->sockets[SOCKET_MEAS], buf, count,
+			&s->sockets[SOCKET_CMDS], session_timeout(s, step));
+	}
+	else if (0 < count) {
+		send_complete(&s->sockets[SOCKET_MEAS], buf, count);
+	}
+	else {
+		socket_flush(&s->sockets[SOCKET_MEAS]);
+	}
+}
+
+/**
+ * Returns the number of hours the next batch may carry: what the
+ * controller asked for, capped to twice the hours produced during
+ * one controller round trip. The batch then grows with the
+ * controller latency, so the backlog drains at throughput rate,
+ * without shipping huge frames to a fast controller.
+ */
+static int32_t batch_limit(struct house_session *s)
+{
+	unsigned long long interval = timer_interval_micros(s->comms_timer);
+	unsigned long long adaptive = s->batch_max;
+
+	/* Until a round trip has been measured, trust the controller. */
+	if ((0 < interval) && (0 < s->rtt_micros)) {
+		adaptive = 2 * ((s->rtt_micros + interval - 1) / interval);
+	}
+	if (1 > adaptive) {
+		adaptive = 1;
+	}
+
+	return (adaptive < s->batch_request) ? (int32_t) adaptive : s->batch_request;
+}
+
+static int recv_CMDS_ctrl(struct house_session *s, const int step)
+{
+	if (!session_read_possible(s, SOCKET_CMDS, step)) {
+		return 1;
+	}
+	int32_t control_in;
+	char *frame = s->cmds_frame;
+
+	if (is_framed(s)) {
+		/* Control and commands come in a single frame. */
+		if ((int) s->cmds_size != wire_recv(&s->sockets[SOCKET_CMDS], WIRE_CMDS, frame, s->cmds_size)) {
+			if (s->sockets[SOCKET_CMDS].started) {
+				/* Drop the controller as if it had left. */
+				WARNING("advance: invalid CMDS frame, closing the connection.\n");
+				socket_close(&s->sockets[SOCKET_CMDS]);
+			}
+			return 1;
+		}
+		if (CB_fromFrame(s->cmds_buffer, frame)) {
+			ERROR("advance: unable to set CMDS buffer.\n");
+		}
+		memcpy(&control_in, frame, sizeof(int32_t));
+	}
+	else {
+		recv_complete(&s->sockets[SOCKET_CMDS], (char *) &control_in, sizeof(int32_t));
+		if (!s->sockets[SOCKET_CMDS].started) {
+			return 1;
+		}
+		if (CB_setControl(s->cmds_buffer, &control_in)) {
+			ERROR("advance: unable to set CMDS control.\n");
+		}
+		if (GB_empty(CB_getBuffer(s->cmds_buffer))) {
+			ERROR("advance: unable to empty CMDS buffer.\n");
+		}
+	}
+	DEBUG_PRINT("advance: received CMDS control message \"%d\".\n", control_in);
+	s->communication_status = COMMS_CMDS_RECV;
 
-	} while (0 < fds_left);
+	return 0;
+}
 
-	DEBUG_PRINT("startServers: all connection accepted at simulation time %.2f.\n", t);
+static int recv_CMDS_buffer(struct house_session *s, const int step)
+{
+	ControlBuffer meas;
+	int32_t control_out;
 
-	/* Initialize timer */
-	comms_timer = create_timer(speed, queries_per_int);
-	if (NULL == comms_timer) {
-		ERROR("startServers: unable to create timer.\n");
+	if (!is_framed(s)) {
+		if (!session_read_possible(s, SOCKET_CMDS, step)) {
+			return 1;
+		}
+		recv_complete(&s->sockets[SOCKET_CMDS], s->cmds_frame, s->cmds_size - sizeof(int32_t));
+		if (!s->sockets[SOCKET_CMDS].started) {
+			return 1;
+		}
+		if (GB_setValues(CB_getBuffer(s->cmds_buffer), s->cmds_frame)) {
+			ERROR("advance: unable to set CMDS values.\n");
+		}
+	}
+	print_CMDS_buffer(s);
+	if (CB_getControl(s->cmds_buffer, &control_out)) {
+		ERROR("advance: unable to get CMDS control.\n");
 	}
 
-	/* Initialize MEAS buffer FIFO */
-	out_meas_buffer = fifo_init();
-	if (NULL == out_meas_buffer) {
-		ERROR("startServers: unable to create FIFO.\n");
+	/* The commands acknowledge every hour of the MEAS frame. */
+	while (NULL != (meas = fifo_pop(s->sent_meas_buffer))) {
+		if (CB_release(meas)) {
+			ERROR("advance: unable to free MEAS buffer.\n");
+		}
 	}
 
-	/* Initialize buffers */
-	meas_buffer = CB_init(MEAS_NUMBER);
-	if (NULL == meas_buffer) {
-		ERROR("startServers: unable to create MEAS control buffer.\n");
+	if (is_framed(s)) {
+		wire_send(&s->sockets[SOCKET_CMDS], WIRE_CMDS_ACK, &control_out, sizeof(int32_t));
 	}
-	cmds_buffer = CB_init(CMDS_NUMBER);
-	if (NULL == cmds_buffer) {
-		ERROR("startServers: unable to create CMDS control buffer.\n");
+	else {
+		send_complete(&s->sockets[SOCKET_CMDS], (char *) &control_out, sizeof (int32_t));
 	}
+	DEBUG_PRINT("advance: CMDS ack sent back to server.\n");
 
-	current_hour = 1;
-	if (CB_setControl(meas_buffer, &current_hour)) {
-		ERROR("startServers: unable to set MEAS control.\n");
-	}
-	if (CB_setControl(cmds_buffer, &current_hour)) {
-		ERROR("startServers: unable to set CMDS contro.\n");
+	/* Exponentially weighted round trip time, alpha = 1/8. */
+	unsigned long long rtt = timer_now_micros() - s->meas_sent_at;
+	s->rtt_micros = (0 == s->rtt_micros) ? rtt : (7 * s->rtt_micros + rtt) / 8;
+	timer_adapt(s->comms_timer, rtt);
+	s->communication_status = COMMS_MEAS_WAIT;
+
+	if (NULL != s->io) {
+		io_push_cmds(s);
 	}
 
-	communication_status = COMMS_MEAS_WAIT;
+	return 0;
 }
 
 /**
- * Buffers the [val] in the [name] slot. Sends all values if the MEAS
- * buffer is full. Throws econnectrror if [name] variable has already been
- * buffered.
+ * Applies the [speed] asked by the controller of [s], which then
+ * keeps it until it asks for another one.
  */
-double sendOM(const double val, const char * const name, const double t, const int32_t ctrl)
+static void set_speed(struct house_session *s, const uint32_t speed)
 {
-//	DEBUG_PRINT("sendOM: called with val: %f, name: %s, t: %f\n", val, name, t);
-	if(!server_is_running()) {
-		WARNING("sendOM: server not started or connection closed.\n");
-		return 0.0;
-	}
-
-	if(NULL == name) {
-		ERROR("sendOM: NULL pointer argument.\n");
+	if (timer_setAdaptive(s->comms_timer, 0) || timer_setSpeed(s->comms_timer, speed)) {
+		ERROR("recv_MEAS_ctrl: unable to set speed.\n");
 	}
-
-	int step = ((int) fmod(t, 60.0));
-
-	send_meas(name, val, ctrl);
-	advance(ctrl, step);
-
-	return val;
-
+	DEBUG_PRINT("recv_MEAS_ctrl: controller set speed %u at hour %d.\n", speed, s->current_hour);
 }
 
 /**
- * Returns the [name] variable received from CMDS socket. If the
- * [name] variable has already been taken, throws an error. If the
- * CMDS buffer is empty, loads data from the socket.
+ * Returns non-zero if the controller of [s] agreed on
+ * length-prefixed frames.
  */
-double getOM(const double val, const char * const name, const double t, const int32_t ctrl)
+static int is_framed(struct house_session *s)
 {
-//	DEBUG_PRINT("getOM: called with parameters (val: %f, name: \"%s\", t: %f)\n", val, name, t);
-	if(!server_is_running()) {
-		WARNING("getOM: server not started or connection closed.\n");
-		return 0.0;
-	}
-
-	if(NULL == name) {
-		ERROR("getOM: NULL pointer argument.\n");
-	}
-
-	int step = ((int) fmod(t, 60.0));
-
-	advance(ctrl, step);
+	return 0 != (s->wire.caps & WIRE_CAP_FRAMED);
+}
 
-	return get_cmds(name, ctrl);
+/**
+ * Returns non-zero if the MEAS frames are compressed, which only
+ * framed controllers may ask for.
+ */
+static int is_compressed(struct house_session *s)
+{
+	return is_framed(s) && (0 != (s->wire.caps & WIRE_CAP_XOR));
 }
 
 /************************************************************
-* Communication functions
+* I/O thread functions
 ************************************************************/
 
-static void advance(const int32_t ctrl, const int step)
+/**
+ * Moves the advance() state machine of [s] to a background
+ * thread. sendOM and getOM then never wait for the network.
+ */
+static void io_thread_start(struct house_session *s)
 {
-	while (current_hour <= ctrl) {
-		switch(communication_status) {
-		case COMMS_MEAS_WAIT:
-			if (recv_MEAS_ctrl(&communication_status, comms_timer, step)) {
-				return;
-			}
-			break;
-
-		case COMMS_MEAS_SEND:
-			if (send_MEAS_buffer(&communication_status, step)) {
-				return;
-			}
-			break;
+	struct io_thread *io = calloc(1, sizeof(*io));
 
-		case COMMS_CMDS_WAIT:
-			if (recv_CMDS_ctrl(&communication_status, comms_timer, step)) {
-				return;
-			}
-			break;
+	if (NULL == io) {
+		ERROR("io_thread_start: unable to allocate I/O thread.\n");
+	}
+	io->meas_queue = spsc_init(IO_QUEUE_SIZE);
+	io->cmds_queue = spsc_init(IO_QUEUE_SIZE);
+	io->meas_backlog = fifo_init();
+	io->cmds = CB_get(s->cmds_pool);
+	if ((NULL == io->meas_queue) || (NULL == io->cmds_queue) || (NULL == io->meas_backlog) || (NULL == io->cmds)) {
+		ERROR("io_thread_start: unable to create I/O queues.\n");
+	}
 
-		case COMMS_CMDS_RECV:
-			if (recv_CMDS_buffer(&communication_status, comms_timer, step)) {
-				return;
-			}
-			++current_hour;
-			break;
+	s->io = io;
+	if (pthread_create(&io->thread, NULL, io_thread_run, s)) {
+		ERROR("io_thread_start: unable to start I/O thread.\n");
+	}
 
-		default:
-			ERROR("advance: status %d is invalid.\n", communication_status);
+	DEBUG_PRINT("io_thread_start: I/O thread started.\n");
+}
 
-		} /* Switch */
-	} /* While */
+/**
+ * Stops the I/O thread of the local session at exit, and removes
+ * its shared memory segment.
+ */
+static void local_context_stop(void)
+{
+	io_thread_stop(&local_context.session);
+	session_detach_shm(&local_context.session);
 }
 
-static int recv_MEAS_ctrl(CommsStatus *status, Timer t, const int step)
+/**
+ * Stops the I/O thread of [s], if any, once the hours already
+ * produced have been exchanged.
+ */
+static void io_thread_stop(struct house_session *s)
 {
-	if (!read_possible(t, step, sockets[SOCKET_MEAS].accept_fd)) {
-		return 1;
+	struct io_thread *io = s->io;
+
+	if ((NULL == io) || pthread_equal(io->thread, pthread_self())) {
+		return;
 	}
-	int32_t control_in;
+	__atomic_store_n(&io->stop, 1, __ATOMIC_RELEASE);
+	pthread_join(io->thread, NULL);
+}
 
-	recv_complete(&sockets[SOCKET_MEAS], (char*) &control_in, sizeof (int32_t));
+/**
+ * I/O thread body: feeds the MEAS buffers queued by the solver to
+ * the FIFO, re-anchoring the timer on each new hour, and advances
+ * the session up to the last hour produced.
+ * Reads only wait IO_WAIT_MILLIS, so that new hours are picked up
+ * while the controller is slow. Once asked to stop, the thread
+ * drains for up to IO_DRAIN_MILLIS.
+ */
+static void *io_thread_run(void *arg)
+{
+	struct house_session *s = arg;
+	struct timespec idle = { 0, IO_IDLE_MICROS * 1000L };
+	ControlBuffer meas;
+	int32_t produced = 0, control;
+	unsigned long long deadline = 0;
+
+	while (s->resumable || session_connected(s)) {
+		if ((0 == deadline) && __atomic_load_n(&s->io->stop, __ATOMIC_ACQUIRE)) {
+			deadline = timer_now_micros() + IO_DRAIN_MILLIS * 1000ULL;
+		}
+		/* Under the block policy, the hours wait in the queue. */
+		while (((FIFO_BLOCK != s->config->fifo_policy) || !fifo_isFull(s->out_meas_buffer))
+			&& (NULL != (meas = spsc_pop(s->io->meas_queue)))) {
+			if (CB_getControl(meas, &control)) {
+				ERROR("io_thread_run: unable to get MEAS control.\n");
+			}
+			if (control > produced) {
+				produced = control;
+				if (reset_timer(s->comms_timer)) {
+					ERROR("io_thread_run: unable to reset timer.\n");
+				}
+			}
+			insert_meas(s, meas);
+		}
 
-	DEBUG_PRINT("recv_MEAS_ctrl: MEAS control message from server is \"%d\".\n", control_in);
+		if (s->current_hour <= produced) {
+			advance(s, produced, 0);
+		}
+		else if (0 != deadline) {
+			break;
+		}
+		else {
+			nanosleep(&idle, NULL);
+		}
+		if ((0 != deadline) && (timer_now_micros() > deadline)) {
+			WARNING("io_thread_run: hours %d to %d never exchanged.\n", s->current_hour, produced);
+			break;
+		}
+	}
 
-	*status = COMMS_MEAS_SEND;
+	__atomic_store_n(&s->io->closed, 1, __ATOMIC_RELEASE);
+	DEBUG_PRINT("io_thread_run: I/O thread stopped at hour %d.\n", s->current_hour);
 
-	return 0;
+	return NULL;
 }
 
-static int send_MEAS_buffer(CommsStatus *status, const int step)
+/**
+ * Solver side: hands [meas] (may be NULL) over to the I/O thread,
+ * after the backlog of buffers the queue had no room for. Under
+ * the block policy of a bounded FIFO, waits for room instead.
+ */
+static void io_queue_meas(struct house_session *s, ControlBuffer meas)
 {
-	if (NULL == fifo_peek(out_meas_buffer)) {
-		return 1;
-	}
+	struct timespec idle = { 0, IO_IDLE_MICROS * 1000L };
+	ControlBuffer pending;
 
-	ControlBuffer extracted_meas_buffer;
-	int32_t control_out;
-	Measures meas_index;
-	double value;
+	if ((NULL != meas) && (0 < s->config->fifo_capacity) && (FIFO_BLOCK == s->config->fifo_policy)) {
+		while (spsc_push(s->io->meas_queue, meas)) {
+			if (!server_is_running(s)) {
+				ERROR("io_queue_meas: MEAS queue full, and no controller left to drain it.\n");
+			}
+			nanosleep(&idle, NULL);
+		}
+		return;
+	}
 
-	extracted_meas_buffer = fifo_pop(out_meas_buffer);
-	/* Holds: extracted_meas_buffer  is not NULL ! */
+	while (NULL != (pending = fifo_peek(s->io->meas_backlog))) {
+		if (spsc_push(s->io->meas_queue, pending)) {
+			break;
+		}
+		fifo_pop(s->io->meas_backlog);
+	}
 
-	if (CB_getControl(extracted_meas_buffer, &control_out)) {
-		ERROR("advance: unable to extract control from MEAS buffer.\n");
+	if (NULL == meas) {
+		return;
 	}
-	send_complete(&sockets[SOCKET_MEAS], (char *) &control_out, sizeof (int32_t));
-	DEBUG_PRINT("advance: sent MEAS control message \"%d\" back.\n", control_out);
-	for (meas_index = 0; meas_index < MEAS_NUMBER; ++meas_index) {
-		if (GB_getValue(CB_getBuffer(extracted_meas_buffer), meas_index, &value)) {
-			ERROR("advance: unable to extract MEAS %d from MEAS buffer.\n", meas_index);
+	if ((NULL != pending) || spsc_push(s->io->meas_queue, meas)) {
+		if (fifo_insert(s->io->meas_backlog, meas)) {
+			ERROR("io_queue_meas: unable to insert MEAS buffer in backlog.\n");
 		}
-		send_complete(&sockets[SOCKET_MEAS], (char *) &value, sizeof(double));
-	}
-	DEBUG_PRINT("advance: sent MEAS buffer.\n");
-	if (CB_destroy(extracted_meas_buffer)) {
-		ERROR("advance: unable to free MEAS buffer.\n");
 	}
-	*status = COMMS_CMDS_WAIT;
-
-	return 0;
 }
 
-static int recv_CMDS_ctrl(CommsStatus *status, Timer t, const int step)
+/**
+ * I/O thread side: hands the CMDS buffer just acknowledged over to
+ * the solver, and starts a new one.
+ */
+static void io_push_cmds(struct house_session *s)
 {
-	if (!read_possible(t, step, sockets[SOCKET_CMDS].accept_fd)) {
-		return 1;
-	}
-	int32_t control_in;
+	struct timespec idle = { 0, IO_IDLE_MICROS * 1000L };
 
-	recv_complete(&sockets[SOCKET_CMDS], (char *) &control_in, sizeof(int32_t));
-	DEBUG_PRINT("advance: received CMDS control message \"%d\".\n", control_in);
-	if (CB_setControl(cmds_buffer, &control_in)) {
-		ERROR("advance: unable to set CMDS control.\n");
-	}
-	if (GB_empty(CB_getBuffer(cmds_buffer))) {
-		ERROR("advance: unable to empty CMDS buffer.\n");
+	while (spsc_push(s->io->cmds_queue, s->cmds_buffer)) {
+		if (__atomic_load_n(&s->io->stop, __ATOMIC_ACQUIRE)) {
+			return;
+		}
+		nanosleep(&idle, NULL);
 	}
-	*status = COMMS_CMDS_RECV;
 
-	return 0;
+	s->cmds_buffer = CB_get(s->cmds_pool);
+	if (NULL == s->cmds_buffer) {
+		ERROR("io_push_cmds: unable to create CMDS control buffer.\n");
+	}
 }
 
-static int recv_CMDS_buffer(CommsStatus *status, Timer t, const int step)
+/**
+ * Solver side: keeps the most recent CMDS buffer received by the
+ * I/O thread.
+ */
+static void io_pull_cmds(struct house_session *s)
 {
-	if (!read_possible(t, step, sockets[SOCKET_CMDS].accept_fd)) {
-		return 1;
-	}
-	Commands cmds_index;
-	double value;
-	int32_t control_out;
+	ControlBuffer cmds;
 
-	for(cmds_index = 0; cmds_index < CMDS_NUMBER; ++cmds_index) {
-		recv_complete(&sockets[SOCKET_CMDS], (char *) &value, sizeof(double));
-		if (GB_setValue(CB_getBuffer(cmds_buffer), cmds_index, &value)) {
-			ERROR("advance: unable to set CMDS value.\n");
+	while (NULL != (cmds = spsc_pop(s->io->cmds_queue))) {
+		if (CB_release(s->io->cmds)) {
+			ERROR("io_pull_cmds: unable to free CMDS buffer.\n");
 		}
+		s->io->cmds = cmds;
 	}
-	print_CMDS_buffer();
-	send_complete(&sockets[SOCKET_CMDS], (char *) &control_out, sizeof (int32_t));
-	DEBUG_PRINT("advance: CMDS ack sent back to server.\n");
-	*status = COMMS_MEAS_WAIT;
-
-	return 0;
 }
 
 /************************************************************
 * Get CMDS and send MEAS functions
 ************************************************************/
 
-static double get_cmds(const char * const name, const int32_t ctrl)
+/**
+ * Loads the schema named by HOUSE_SCHEMA, unless one is in use:
+ * the model may ask for handles before starting the servers.
+ */
+static void load_schema(void)
 {
-	if(NULL == name) {
-		ERROR("get_cmds: NULL pointer argument.\n");
+	char path[CONFIG_PATH_LENGTH];
+
+	if (house_hasSchema()) {
+		return;
+	}
+	config_loadSchemaPath(path);
+	if (house_loadSchema(path)) {
+		ERROR("load_schema: unable to use schema \"%s\".\n", path);
 	}
+}
 
-	double ret = 0.0;
-	Commands index = get_CMDS_num_from_name(name);
+/**
+ * Returns the MEAS of [handle], throwing an error on behalf of
+ * [fname] if it is not a valid handle in the schema of session
+ * [s]. The session keeps the schema, so that the exchange never
+ * takes the lock of the shared one.
+ */
+static int check_MEAS_handle(const struct house_session *s, const int handle, const char * const fname)
+{
+	if((0 > handle) || (schema_count(s->schema, SCHEMA_MEAS) <= handle)) {
+		ERROR("%s: invalid MEAS handle %d.\n", fname, handle);
+	}
+	return handle;
+}
+
+/**
+ * Returns the CMDS of [handle], throwing an error on behalf of
+ * [fname] if it is not a valid handle in the schema of session
+ * [s].
+ */
+static int check_CMDS_handle(const struct house_session *s, const int handle, const char * const fname)
+{
+	if((0 > handle) || (schema_count(s->schema, SCHEMA_CMDS) <= handle)) {
+		ERROR("%s: invalid CMDS handle %d.\n", fname, handle);
+	}
+	return handle;
+}
+
+/**
+ * Returns the handle of the [kind] [name] in the schema of session
+ * [s], throwing an error on behalf of [fname] if there is none.
+ * Before the session starts, resolves it like getMEASHandle and
+ * getCMDSHandle.
+ */
+static int session_find(const struct house_session *s, const SchemaKinds kind, const char * const name,
+	const char * const fname)
+{
+	int index;
 
-	if((CMDS_NUMBER <= index)) {
-		ERROR("get_cmds: unkwon name \"%s\".\n", name);
+	if (NULL == s->schema) {
+		return (SCHEMA_MEAS == kind) ? getMEASHandle(name) : getCMDSHandle(name);
+	}
+	if (0 > (index = schema_find(s->schema, kind, name))) {
+		ERROR("%s: unknown name \"%s\".\n", fname, name);
 	}
+	return index;
+}
 
+static double get_cmds(ControlBuffer cmds, const int index, const int32_t ctrl)
+{
+	double ret = 0.0;
 	int32_t tmp_control = 0;
-	if (CB_getControl(cmds_buffer, &tmp_control)) {
+	if (CB_getControl(cmds, &tmp_control)) {
 		ERROR("get_cmds: unable to get CMDS contorl.\n");
 	}
-	if (GB_isFull(CB_getBuffer(cmds_buffer)) && (ctrl == tmp_control)) {
-		if (GB_getValue(CB_getBuffer(cmds_buffer), index, &ret)) {
+	if (GB_isFull(CB_getBuffer(cmds)) && (ctrl == tmp_control)) {
+		if (GB_getDouble(CB_getBuffer(cmds), index, &ret)) {
 			ERROR("get_cmds: unable to get CMDS %d.\n", index);
 		}
 	}
@@ -354,85 +1882,308 @@ static double get_cmds(const char * const name, const int32_t ctrl)
 
 /**
  * @prec: must be called once per MEAS name, per time slot.
+ * The measures that are not due in the hour of [ctrl] are
+ * ignored: their values would not be sent.
  */
-static void send_meas(const char * const name, const double value, const int32_t ctrl)
+static void send_meas(struct house_session *s, const int index, const double value, const int32_t ctrl, const int step)
 {
-	if (NULL == name) {
-		ERROR("send_meas: NULL pointer argument.\n");
-	}
-
 	int32_t current_meas_control = 0, zero_ctrl = 0;
-	Measures index;
+	int due = schema_isDue(s->schema, index, ctrl);
+
+	/* The hour is gone already. */
+	if (!due && (ctrl == s->meas_queued)) {
+		return;
+	}
 
 	/* If the current ctrl differs from the control on the MEAS buffer,
 	 * a new hour has begun. */
-	if (CB_getControl(meas_buffer, &current_meas_control)) {
+	if (CB_getControl(s->meas_buffer, &current_meas_control)) {
 		ERROR("send_meas: unable to get MEAS control.\n");
 	}
 	if (ctrl != current_meas_control) {
-		if (CB_setControl(meas_buffer, &ctrl)) {
+		if (CB_setControl(s->meas_buffer, &ctrl)) {
 			ERROR("send_meas: unable to set MEAS control.\n");
 		}
-		if (reset_timer(comms_timer)) {
+		/* The I/O thread owns the timer, and re-anchors it when it
+		 * dequeues the hour. */
+		if ((NULL == s->io) && reset_timer(s->comms_timer)) {
 			ERROR("send_meas: unable to reset timer.\n");
 		}
+		s->meas_due = schema_dueCount(s->schema, ctrl);
+	}
+	if (!due) {
+		return;
 	}
 
 	/* Set value in MEAS buffer. */
-	index = get_MEAS_num_from_name(name);
-	if ((MEAS_NUMBER <= index)) {
-		ERROR("send_meas: unkwon name \"%s\".\n", name);
+	if (GB_isSet(CB_getBuffer(s->meas_buffer), index)) {
+		WARNING("send_meas: %s already set.\n", schema_label(s->schema, SCHEMA_MEAS, index));
 	}
-	if (GB_isSet(CB_getBuffer(meas_buffer), index)) {
-		WARNING("send_meas: \"%s\" already set.\n", name);
+	else {
+		--s->meas_due;
 	}
-	if (GB_setValue(CB_getBuffer(meas_buffer), index, &value)) {
+	if (GB_setDouble(CB_getBuffer(s->meas_buffer), index, value)) {
 		ERROR("send_meas: unable to set MEAS buffer value.\n");
 	}
 
-	/* If the MEAS buffer is full, add it to the FIFO,
-	 * create a new one, and set its control to 0 */
-	if (GB_isFull(CB_getBuffer(meas_buffer))) {
-		print_MEAS_buffer(); // Debug
-		if (fifo_insert(out_meas_buffer, meas_buffer)) {
-			ERROR("send_meas: unable to insert MEAS buffer in FIFO.\n");
+	/* Once all the measures due are set, add the MEAS buffer to
+	 * the FIFO, create a new one, and set its control to 0 */
+	if (0 == s->meas_due) {
+		s->meas_queued = ctrl;
+		print_MEAS_buffer(s); // Debug
+		if (NULL != s->io) {
+			io_queue_meas(s, s->meas_buffer);
 		}
-		meas_buffer = CB_init(MEAS_NUMBER);
-		if (NULL == meas_buffer) {
+		else {
+			queue_meas(s, s->meas_buffer, ctrl, step);
+		}
+		s->meas_buffer = CB_get(s->meas_pool);
+		if (NULL == s->meas_buffer) {
 			ERROR("send_meas: unable to create new MEAS control buffer.\n");
 		}
-		if (CB_setControl(meas_buffer, &zero_ctrl)) {
+		if (CB_setControl(s->meas_buffer, &zero_ctrl)) {
 			ERROR("send_meas: unable to reset MEAS control.\n");
 		}
 	}
 }
 
+/**
+ * Queues the complete hour [meas] of [ctrl] for the controller.
+ * Under the block policy, a full FIFO holds the solver in the
+ * exchange until the controller makes room.
+ */
+static void queue_meas(struct house_session *s, ControlBuffer meas, const int32_t ctrl, const int step)
+{
+	struct timespec idle = { 0, IO_IDLE_MICROS * 1000L };
+
+	while (insert_meas(s, meas)) {
+		if (!server_is_running(s)) {
+			ERROR("send_meas: MEAS FIFO full, and no controller left to drain it.\n");
+		}
+		advance(s, ctrl, step);
+		if (fifo_isFull(s->out_meas_buffer)) {
+			nanosleep(&idle, NULL);
+		}
+	}
+}
+
+/**
+ * Inserts [meas] in the MEAS FIFO of [s]. The hours the FIFO drops
+ * to make room count as exchanged, so that the exchange moves on
+ * to the ones still queued.
+ * Returns 0 on success, non-zero if a blocking FIFO is full.
+ */
+static int insert_meas(struct house_session *s, ControlBuffer meas)
+{
+	unsigned long dropped;
+	int rv = fifo_insert(s->out_meas_buffer, meas);
+
+	if (FIFO_FULL == rv) {
+		return 1;
+	}
+	if (rv) {
+		ERROR("send_meas: unable to insert MEAS buffer in FIFO.\n");
+	}
+
+	dropped = fifo_drops(s->out_meas_buffer);
+	if (dropped != s->dropped_hours) {
+		if (0 == s->dropped_hours) {
+			WARNING("send_meas: MEAS FIFO full, dropping hours from hour %d.\n", s->current_hour);
+		}
+		s->current_hour += dropped - s->dropped_hours;
+		s->dropped_hours = dropped;
+	}
+
+	return 0;
+}
+
+/**
+ * Writes the control of [meas] and its measures due in that hour
+ * to [frame]. Returns the size written.
+ */
+static size_t meas_toFrame(struct house_session *s, ControlBuffer meas, char * const frame)
+{
+	int32_t control;
+	double value;
+	char *p = frame + sizeof(int32_t);
+	int i, count = schema_count(s->schema, SCHEMA_MEAS);
+
+	if (!schema_isMultirate(s->schema)) {
+		if (CB_toFrame(meas, frame)) {
+			ERROR("advance: unable to extract MEAS buffer.\n");
+		}
+		return s->hour_size;
+	}
+
+	if (CB_getControl(meas, &control)) {
+		ERROR("advance: unable to get MEAS control.\n");
+	}
+	memcpy(frame, &control, sizeof(int32_t));
+	for (i = 0; i < count; ++i) {
+		if (!schema_isDue(s->schema, i, control)) {
+			continue;
+		}
+		if (GB_getDouble(CB_getBuffer(meas), i, &value)) {
+			ERROR("advance: unable to extract MEAS value.\n");
+		}
+		memcpy(p, &value, sizeof(double));
+		p += sizeof(double);
+	}
+	return p - frame;
+}
+
+/**
+ * meas_toFrame for a compressed MEAS frame: codes the control of
+ * [meas] and its measures due in that hour to [stream].
+ */
+static void meas_toStream(struct house_session *s, ControlBuffer meas, struct gorilla_stream *stream)
+{
+	int32_t control;
+	double value;
+	int i, count = schema_count(s->schema, SCHEMA_MEAS);
+
+	if (CB_getControl(meas, &control) || gorilla_putControl(s->gorilla, stream, control)) {
+		ERROR("advance: unable to compress MEAS control.\n");
+	}
+	for (i = 0; i < count; ++i) {
+		if (!schema_isDue(s->schema, i, control)) {
+			continue;
+		}
+		if (GB_getDouble(CB_getBuffer(meas), i, &value) || gorilla_putValue(s->gorilla, stream, i, value)) {
+			ERROR("advance: unable to compress MEAS value.\n");
+		}
+	}
+}
+
+/**
+ * Recycles a MEAS buffer dropped by the FIFO.
+ */
+static void release_meas(void *meas)
+{
+	if (CB_release(meas)) {
+		ERROR("release_meas: unable to free MEAS buffer.\n");
+	}
+}
+
 /************************************************************
 * Local buffer utilities
 ************************************************************/
 
-static int server_is_running(void)
+/**
+ * Returns non-zero while the controller of [s] is connected, or
+ * may connect again. With an I/O thread, only that thread looks at
+ * the sockets.
+ */
+static int server_is_running(struct house_session *s)
+{
+	if (NULL != s->io) {
+		return !__atomic_load_n(&s->io->closed, __ATOMIC_ACQUIRE);
+	}
+	return s->resumable || session_connected(s);
+}
+
+static int session_connected(struct house_session *s)
+{
+	return s->sockets[SOCKET_CMDS].started && s->sockets[SOCKET_MEAS].started;
+}
+
+static void print_session_stats(struct house_session *s, const char * const name)
+{
+	char socket_name[64];
+
+	if (1 >= s->current_hour) {
+		return;
+	}
+	WARNING("%s: %d hours exchanged, at speed %u in the end.\n", name, s->current_hour - 1, timer_getSpeed(s->comms_timer));
+	snprintf(socket_name, sizeof(socket_name), "%s MEAS", name);
+	socket_printStats(&s->sockets[SOCKET_MEAS], socket_name);
+	snprintf(socket_name, sizeof(socket_name), "%s CMDS", name);
+	socket_printStats(&s->sockets[SOCKET_CMDS], socket_name);
+	timer_printStats(s->comms_timer, name);
+	snprintf(socket_name, sizeof(socket_name), "%s MEAS queue", name);
+	fifo_printStats(s->out_meas_buffer, socket_name);
+	WARNING("%s: %lu MEAS and %lu CMDS buffers allocated.\n",
+		name, CB_poolAllocated(s->meas_pool), CB_poolAllocated(s->cmds_pool));
+	print_session_histograms(s, name);
+}
+
+/**
+ * Writes to [name] how the statistics of session [s] are labelled.
+ */
+static void session_name(const struct house_session *s, char *name, const size_t size)
+{
+	if (0 <= s->house) {
+		snprintf(name, size, "house %d", s->house);
+	}
+	else if (&local_context.session == s) {
+		snprintf(name, size, "local");
+	}
+	else {
+		/* The session starts its context. */
+		snprintf(name, size, "context %p", (void *) s);
+	}
+}
+
+static void print_session_histograms(struct house_session *s, const char * const name)
+{
+	char hist_name[96];
+	CommsStatus status;
+
+	for (status = 0; status < COMMS_NUMBER; ++status) {
+		if (0 == hist_count(s->wait_hist[status])) {
+			continue;
+		}
+		WARNING("%s %s: %lu missed deadlines.\n", name, comms_status_names[status], s->misses[status]);
+		snprintf(hist_name, sizeof(hist_name), "%s %s wait", name, comms_status_names[status]);
+		hist_print(s->wait_hist[status], hist_name, "us");
+		snprintf(hist_name, sizeof(hist_name), "%s %s slack", name, comms_status_names[status]);
+		hist_print(s->slack_hist[status], hist_name, "us");
+		snprintf(hist_name, sizeof(hist_name), "%s %s overrun", name, comms_status_names[status]);
+		hist_print(s->overrun_hist[status], hist_name, "us");
+	}
+}
+
+/**
+ * Makes SIGUSR1 dump the statistics, unless the application
+ * already handles it.
+ */
+static void stats_signal_install(void)
+{
+	struct sigaction action, previous;
+
+	if (sigaction(SIGUSR1, NULL, &previous) || (SIG_DFL != previous.sa_handler)) {
+		return;
+	}
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stats_signal_handler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	if (sigaction(SIGUSR1, &action, NULL)) {
+		WARNING("startServers: unable to install the SIGUSR1 handler.\n");
+	}
+}
+
+static void stats_signal_handler(int sig)
 {
-	return (0 < sockets[SOCKET_CMDS].accept_fd) && (0 < sockets[SOCKET_MEAS].accept_fd);
+	++stats_requested;
 }
 
-static void print_MEAS_buffer(void)
+static void print_MEAS_buffer(struct house_session *s)
 {
 	int32_t control = 0;
-	if(CB_getControl(meas_buffer, &control)) {
+	if(CB_getControl(s->meas_buffer, &control)) {
 		ERROR("print_MEAS_buffer: unable to get MEAS control.\n");
 	}
 	DEBUG_PRINT("MEAS buffer control is set to %d.\n", control);
-	GB_print(CB_getBuffer(meas_buffer), (PrintFunction) get_MEAS_name_from_num);
+	GB_print(CB_getBuffer(s->meas_buffer), (PrintFunction) get_MEAS_name_from_num);
 }
 
-static void print_CMDS_buffer(void)
+static void print_CMDS_buffer(struct house_session *s)
 {
 	int32_t control = 0;
-	if(CB_getControl(meas_buffer, &control)) {
+	if(CB_getControl(s->meas_buffer, &control)) {
 		ERROR("print_CMDS_buffer: unable to get CMDS control.\n");
 	}
 	DEBUG_PRINT("CMDS buffer control is set to %d.\n", control);
-	GB_print(CB_getBuffer(cmds_buffer), (PrintFunction) get_CMDS_name_from_num);
+	GB_print(CB_getBuffer(s->cmds_buffer), (PrintFunction) get_CMDS_name_from_num);
 }
-
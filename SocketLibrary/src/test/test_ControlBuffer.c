@@ -1,8 +1,141 @@
 #include <ControlBuffer.h>
 #include <GeneralBuffer.h>
+#include <Fifo.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MEAS	6
+#define HOURS	1000
+
+/* Heap allocation counter: the test binary interposes the glibc
+ * allocator, for itself and the library. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+static unsigned long allocations;
+
+void *malloc(size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	++allocations;
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+	++allocations;
+	return __libc_realloc(p, size);
+}
+
+/* Hours as the library runs them: filled from the pool, queued,
+ * framed, then released. Calls under test are kept out of the
+ * asserts, which -DNDEBUG removes. */
+static void run_hours(CBPool pool, FIFO queue, const int hours)
+{
+	char frame[sizeof(int32_t) + MEAS * sizeof(double)];
+	ControlBuffer meas;
+	int32_t hour;
+	int i, ret;
+
+	for (hour = 1; hour <= hours; ++hour) {
+		meas = CB_get(pool);
+		assert(NULL != meas);
+		assert(GB_isEmpty(CB_getBuffer(meas)));
+		ret = CB_setControl(meas, &hour);
+		assert(0 == ret);
+		for (i = 0; i < MEAS; ++i) {
+			ret = GB_setDouble(CB_getBuffer(meas), i, hour * 0.5);
+			assert(0 == ret);
+		}
+		ret = fifo_insert(queue, meas);
+		assert(0 == ret);
+		/* Two hours in flight. */
+		if (1 < fifo_size(queue)) {
+			meas = fifo_pop(queue);
+			ret = CB_toFrame(meas, frame);
+			assert(0 == ret);
+			ret = CB_release(meas);
+			assert(0 == ret);
+		}
+	}
+}
+
+static void test_pool(void)
+{
+	CBPool pool = CB_initPool(MEAS);
+	CBPool empty = CB_initPool(0);
+	FIFO queue = fifo_initBounded(4, FIFO_BLOCK, NULL);
+	unsigned long warm;
+
+	assert(NULL == empty);
+	assert((NULL != pool) && (NULL != queue));
+
+	run_hours(pool, queue, 10);
+	assert(2 == CB_poolAllocated(pool));
+
+	/* Warm: no allocation at all. */
+	warm = allocations;
+	assert(0 < warm);
+	run_hours(pool, queue, HOURS);
+	assert(warm == allocations);
+	assert(2 == CB_poolAllocated(pool));
+
+	CB_release(fifo_pop(queue));
+	fifo_destroy(queue);
+	CB_destroyPool(pool);
+}
+
+/* A frame written by one buffer reads back into another. */
+static void test_frame(void)
+{
+	ControlBuffer out = CB_init(3), in = CB_init(3);
+	char frame[sizeof(int32_t) + 3 * sizeof(double)];
+	int32_t control = 7;
+	double v;
+	int i, ret;
+
+	assert(sizeof(frame) == CB_frameSize(out));
+	ret = CB_setControl(out, &control);
+	assert(0 == ret);
+	/* Only full buffers are framed. */
+	ret = CB_toFrame(out, frame);
+	assert(0 != ret);
+	for (i = 0; i < 3; ++i) {
+		ret = GB_setDouble(CB_getBuffer(out), i, i + 0.5);
+		assert(0 == ret);
+	}
+	ret = CB_toFrame(out, frame);
+	assert(0 == ret);
+	memcpy(&control, frame, sizeof(int32_t));
+	assert(7 == control);
+
+	ret = GB_markAsDelivered(CB_getBuffer(in), 1);
+	assert(0 == ret);
+	ret = CB_fromFrame(in, frame);
+	assert(0 == ret);
+	ret = CB_getControl(in, &control);
+	assert(0 == ret);
+	assert(7 == control);
+	assert(GB_isFull(CB_getBuffer(in)));
+	assert(!GB_isDelivered(CB_getBuffer(in), 1));
+	for (i = 0; i < 3; ++i) {
+		ret = GB_getDouble(CB_getBuffer(in), i, &v);
+		assert(0 == ret);
+		assert(i + 0.5 == v);
+	}
+
+	CB_destroy(out);
+	CB_destroy(in);
+}
 
 int main(void)
 {
@@ -23,11 +156,14 @@ int main(void)
 	GB_setValue(my_buffer, 1, &v);
 
 	CB_getControl(my_control_buffer, &i);
-	printf("Control extracted is %ld\n", i);
+	printf("Control extracted is %d\n", i);
 	CB_print(my_control_buffer);
 
 	CB_destroy(my_control_buffer);
 
+	test_frame();
+	test_pool();
+
 	return 0;
 }
 
@@ -9,6 +9,114 @@ void myPrint(void *obj)
 	fprintf(stderr, "My object is the integer '%d'.\n", *((int *) obj));
 }
 
+static int released;
+
+void myRelease(void *obj)
+{
+	++released;
+	free(obj);
+}
+
+static int *newInt(const int v)
+{
+	int *i = malloc(sizeof *i);
+	assert(NULL != i);
+	*i = v;
+	return i;
+}
+
+/* Pops [f] and checks the items count up from [first]. */
+static void checkPops(FIFO f, int first, const int last)
+{
+	int *rm;
+
+	for(; first <= last; ++first) {
+		rm = fifo_pop(f);
+		assert((NULL != rm) && (first == *rm));
+		free(rm);
+	}
+	assert(NULL == fifo_pop(f));
+}
+
+static void testPolicies(void)
+{
+	FIFO f;
+	int *i;
+	int j;
+
+	assert(NULL == fifo_initBounded(4, FIFO_POLICY_NUMBER, myRelease));
+	assert(NULL == fifo_initBounded(4, FIFO_DROP_OLDEST, NULL));
+
+	/* Block: the caller keeps the item. */
+	f = fifo_initBounded(4, FIFO_BLOCK, NULL);
+	assert(NULL != f);
+	for(j = 0; j < 4; ++j) {
+		assert(0 == fifo_insert(f, newInt(j)));
+	}
+	assert(fifo_isFull(f));
+	i = newInt(4);
+	assert(FIFO_FULL == fifo_insert(f, i));
+	free(fifo_pop(f));
+	assert(!fifo_isFull(f));
+	assert(0 == fifo_insert(f, i));
+	checkPops(f, 1, 4);
+	assert(4 == fifo_highWater(f));
+	assert(0 == fifo_drops(f));
+	fifo_destroy(f);
+
+	/* Drop oldest: the last 4 of 10 are kept. */
+	released = 0;
+	f = fifo_initBounded(4, FIFO_DROP_OLDEST, myRelease);
+	for(j = 0; j < 10; ++j) {
+		assert(0 == fifo_insert(f, newInt(j)));
+	}
+	assert((6 == released) && (6 == fifo_drops(f)));
+	fifo_printStats(f, "drop");
+	checkPops(f, 6, 9);
+	fifo_destroy(f);
+
+	/* Coalesce: the first 3 of 10 are kept, then the last one. */
+	released = 0;
+	f = fifo_initBounded(4, FIFO_COALESCE, myRelease);
+	for(j = 0; j < 10; ++j) {
+		assert(0 == fifo_insert(f, newInt(j)));
+	}
+	assert((6 == released) && (6 == fifo_drops(f)));
+	free(fifo_pop(f));
+	free(fifo_pop(f));
+	free(fifo_pop(f));
+	checkPops(f, 9, 9);
+	fifo_destroy(f);
+}
+
+static void testRequeue(void)
+{
+	FIFO f = fifo_initBounded(3, FIFO_BLOCK, NULL), from = fifo_init();
+	int j;
+
+	/* Wrap the ring around first. */
+	assert(0 == fifo_insert(f, newInt(0)));
+	assert(0 == fifo_insert(f, newInt(0)));
+	free(fifo_pop(f));
+	free(fifo_pop(f));
+	for(j = 3; j < 6; ++j) {
+		assert(0 == fifo_insert(f, newInt(j)));
+	}
+	for(j = 0; j < 3; ++j) {
+		assert(0 == fifo_insert(from, newInt(j)));
+	}
+
+	/* Requeued items go in front, past the capacity. */
+	assert(0 == fifo_requeue(f, from));
+	assert(0 == fifo_size(from));
+	assert(6 == fifo_size(f));
+	assert(FIFO_FULL == fifo_insert(f, NULL));
+	checkPops(f, 0, 5);
+
+	fifo_destroy(f);
+	fifo_destroy(from);
+}
+
 int main(void)
 {
 
@@ -54,9 +162,13 @@ int main(void)
 	}
 
 	fifo_print(f, myPrint);
+	assert(100 == fifo_highWater(f));
 
 	fifo_destroy(f);
 
+	testPolicies();
+	testRequeue();
+
 	return 0;
 }
 
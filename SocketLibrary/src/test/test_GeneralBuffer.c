@@ -2,7 +2,95 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <assert.h>
 
+/* Status checks across bitmap words, sizes not a multiple of 64. */
+static void test_status(const int size)
+{
+	GBuffer b = GB_initDouble(size);
+	double v = 0.5, got;
+	int i;
+
+	assert(NULL != b);
+	assert(GB_isEmpty(b));
+	assert(!GB_isFull(b));
+	assert(!GB_isAllDelivered(b));
+	assert(0 != GB_getValue(b, 0, &got));
+	assert(0 != GB_setValue(b, size, &v));
+	assert(0 != GB_setValue(b, -1, &v));
+
+	for(i = 0; i < size; ++i) {
+		assert(!GB_isFull(b));
+		v = i;
+		assert(0 == GB_setValue(b, i, &v));
+		assert(!GB_isEmpty(b));
+	}
+	assert(GB_isFull(b));
+	assert(0 == GB_getValue(b, size - 1, &got));
+	assert(size - 1 == got);
+
+	for(i = size - 1; i >= 0; --i) {
+		assert(!GB_isAllDelivered(b));
+		assert(0 == GB_markAsDelivered(b, i));
+		assert(GB_isDelivered(b, i));
+	}
+	assert(GB_isAllDelivered(b));
+	assert(GB_isFull(b));
+
+	/* Unset clears both bits, set does not deliver. */
+	assert(0 == GB_unset(b, size / 2));
+	assert(!GB_isSet(b, size / 2));
+	assert(!GB_isDelivered(b, size / 2));
+	assert(!GB_isFull(b));
+	assert(0 == GB_set(b, size / 2));
+	assert(GB_isFull(b));
+	assert(!GB_isAllDelivered(b));
+
+	assert(0 == GB_empty(b));
+	assert(GB_isEmpty(b));
+	assert(!GB_isSet(b, 0));
+	GB_destroy(b);
+}
+
+
+static void test_typed(void)
+{
+	GBuffer d = GB_initDouble(3), l = GB_initLongInt(3), f = GB_initFloat(3);
+	double dv;
+	int32_t lv;
+	float fv;
+
+	assert((NULL != d) && (NULL != l) && (NULL != f));
+
+	assert(0 == GB_setDouble(d, 0, 1.5));
+	assert(0 == GB_getDouble(d, 0, &dv));
+	assert(1.5 == dv);
+	assert(0 == GB_setLongInt(l, 1, -7));
+	assert(0 == GB_getLongInt(l, 1, &lv));
+	assert(-7 == lv);
+	assert(0 == GB_setFloat(f, 2, 0.25f));
+	assert(0 == GB_getFloat(f, 2, &fv));
+	assert(0.25f == fv);
+
+	/* The generic accessors agree with the typed ones. */
+	assert(0 == GB_getValue(f, 2, &fv));
+	assert(0.25f == fv);
+	lv = 42;
+	assert(0 == GB_setValue(l, 2, &lv));
+	assert(0 == GB_getLongInt(l, 2, &lv));
+	assert(42 == lv);
+
+	/* Checked variants reject wrong types, ranges and empty slots. */
+	assert(0 != GB_getDoubleChecked(f, 2, &dv));
+	assert(0 != GB_setFloatChecked(d, 0, 1.0f));
+	assert(0 != GB_setDoubleChecked(d, 3, 1.0));
+	assert(0 != GB_getDoubleChecked(d, 1, &dv));
+
+	GB_print(f, NULL);
+	GB_destroy(d);
+	GB_destroy(l);
+	GB_destroy(f);
+}
 
 int main(void)
 {
@@ -31,6 +119,13 @@ int main(void)
 
 	GB_destroy(my_buffer_double);
 
+	test_status(1);
+	test_status(6);
+	test_status(64);
+	test_status(65);
+	test_status(130);
+	test_typed();
+
 	return 0;
 }
 
@@ -0,0 +1,107 @@
+#include <Gorilla.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#define SERIES	3
+#define HOURS	500
+
+/* Slowly changing series, a constant one, and special values. */
+static double sample(const int series, const int hour)
+{
+	switch (series) {
+	case 0:
+		return 3.5 + sin(hour / 24.0 * 6.283185307179586);
+	case 1:
+		return 0.05;
+	default:
+		return (hour % 100 == 7) ? NAN : (hour % 100 == 8) ? -0.0 : hour * 1e300;
+	}
+}
+
+/* Controls of consecutive hours, with gaps, jumps and wrap. */
+static int32_t control(const int hour)
+{
+	if (HOURS - 3 <= hour) {
+		return (HOURS - 1 == hour) ? INT32_MIN : INT32_MAX - (HOURS - 2 - hour);
+	}
+	return 1 + hour + ((hour > 100) ? 40 : 0) + ((hour > 200) ? 100000 : 0);
+}
+
+/* What is written is read back bit for bit, in less room. */
+static void test_roundtrip(void)
+{
+	Gorilla enc = gorilla_init(SERIES), dec = gorilla_init(SERIES);
+	size_t size = HOURS * gorilla_maxSize(SERIES);
+	uint8_t *data = malloc(size);
+	struct gorilla_stream w, r;
+	int32_t ctrl;
+	double value, expected;
+	int h, i;
+
+	assert((NULL != enc) && (NULL != dec) && (NULL != data));
+	gorilla_open(&w, data, size);
+	for (h = 0; h < HOURS; ++h) {
+		assert(0 == gorilla_putControl(enc, &w, control(h)));
+		for (i = 0; i < SERIES; ++i) {
+			assert(0 == gorilla_putValue(enc, &w, i, sample(i, h)));
+		}
+	}
+	size = gorilla_close(&w);
+	assert(size < HOURS * (sizeof(int32_t) + SERIES * sizeof(double)));
+
+	gorilla_open(&r, data, size);
+	for (h = 0; h < HOURS; ++h) {
+		assert(0 == gorilla_getControl(dec, &r, &ctrl));
+		assert(control(h) == ctrl);
+		for (i = 0; i < SERIES; ++i) {
+			assert(0 == gorilla_getValue(dec, &r, i, &value));
+			expected = sample(i, h);
+			assert(0 == memcmp(&expected, &value, sizeof(double)));
+		}
+	}
+	/* The hour count bounds the reads: the padding of the last
+	 * byte would read as hours, but an empty stream fails. */
+	gorilla_open(&r, data, 0);
+	assert(0 != gorilla_getControl(dec, &r, &ctrl));
+
+	free(data);
+	gorilla_destroy(enc);
+	gorilla_destroy(dec);
+}
+
+/* Constant hours cost a few bits, and a reset starts over. */
+static void test_reset(void)
+{
+	Gorilla g = gorilla_init(1);
+	uint8_t data[64];
+	struct gorilla_stream w;
+	int h;
+
+	assert(NULL == gorilla_init(0));
+	gorilla_open(&w, data, sizeof(data));
+	for (h = 1; h <= 64; ++h) {
+		assert(0 == gorilla_putControl(g, &w, h));
+		assert(0 == gorilla_putValue(g, &w, 0, 0.05));
+	}
+	/* First hour in full, then 2 bits an hour. */
+	assert(gorilla_maxSize(1) + 64 * 2 / 8 >= gorilla_close(&w));
+	assert(0 != gorilla_putValue(g, &w, 1, 0.05));
+
+	gorilla_reset(g);
+	gorilla_open(&w, data, 2);
+	assert(0 != gorilla_putValue(g, &w, 0, 0.05));
+	gorilla_destroy(g);
+}
+
+int main(int argc, char *argv[])
+{
+	test_roundtrip();
+	test_reset();
+
+	return 0;
+}
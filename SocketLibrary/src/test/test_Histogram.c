@@ -0,0 +1,56 @@
+#include <Histogram.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define SAMPLES	100000ULL
+
+/* Within the bucket precision of [expected]. */
+static int close_to(const unsigned long long value, const unsigned long long expected)
+{
+	return (value >= expected) && (value <= expected + expected / 16 + 1);
+}
+
+int main(void)
+{
+	Histogram h = hist_init();
+	unsigned long long v;
+
+	assert(NULL != h);
+	assert(0 == hist_count(h));
+	assert(0 == hist_percentile(h, 50.0));
+	assert(0 != hist_record(NULL, 1));
+
+	/* Small values are exact. */
+	for (v = 0; v < 32; ++v) {
+		assert(0 == hist_record(h, v));
+	}
+	assert(32 == hist_count(h));
+	assert(15 == hist_percentile(h, 50.0));
+	assert(31 == hist_percentile(h, 100.0));
+	hist_destroy(h);
+
+	/* Uniform values, percentiles within the bucket width. */
+	h = hist_init();
+	for (v = 1; v <= SAMPLES; ++v) {
+		assert(0 == hist_record(h, v));
+	}
+	assert(SAMPLES == hist_count(h));
+	assert(SAMPLES == hist_max(h));
+	assert(close_to(hist_percentile(h, 50.0), SAMPLES / 2));
+	assert(close_to(hist_percentile(h, 90.0), SAMPLES * 9 / 10));
+	assert(close_to(hist_percentile(h, 99.0), SAMPLES * 99 / 100));
+	assert(SAMPLES == hist_percentile(h, 100.0));
+	hist_print(h, "uniform", "us");
+	hist_destroy(h);
+
+	/* Huge values are clamped, the maximum stays exact. */
+	h = hist_init();
+	assert(0 == hist_record(h, HIST_MAX_VALUE * 4));
+	assert(HIST_MAX_VALUE * 4 == hist_max(h));
+	assert(HIST_MAX_VALUE <= hist_percentile(h, 50.0));
+	hist_destroy(h);
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include <NameTable.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+/* Every name is found at its index, and only the names are found. */
+static void test_find(void)
+{
+	static const char * const names[] = {
+		"energy", "consumption", "production", "battery", "phev", "phev_ready_hours"
+	};
+	const int count = sizeof(names) / sizeof(names[0]);
+	NameTable t = names_init(names, count);
+	int i;
+
+	assert(NULL != t);
+	assert(count == names_count(t));
+	for(i = 0; i < count; ++i) {
+		assert(i == names_find(t, names[i]));
+		assert(names_get(t, i) != names[i]);
+	}
+	assert(NULL == names_get(t, count));
+	assert(-1 == names_find(t, ""));
+	assert(-1 == names_find(t, "phe"));
+	assert(-1 == names_find(t, "phev_"));
+	assert(-1 == names_find(t, "Energy"));
+	assert(-1 == names_find(t, NULL));
+
+	names_destroy(t);
+}
+
+/* Larger tables still get a perfect hash, duplicates get none. */
+static void test_build(void)
+{
+	static const char * const dup[] = { "a", "b", "a" };
+	char buf[256][8];
+	const char *names[256];
+	NameTable t, none;
+	int i;
+
+	for(i = 0; i < 256; ++i) {
+		snprintf(buf[i], sizeof(buf[i]), "m%d", i);
+		names[i] = buf[i];
+	}
+	t = names_init(names, 256);
+	assert(NULL != t);
+	for(i = 0; i < 256; ++i) {
+		assert(i == names_find(t, buf[i]));
+	}
+	assert(-1 == names_find(t, "m256"));
+	names_destroy(t);
+
+	none = names_init(dup, 3);
+	assert(NULL == none);
+	none = names_init(names, 0);
+	assert(NULL == none);
+}
+
+/* The House lookups go through the tables. */
+static void test_house(void)
+{
+	assert(MEAS_PHEV_READY_HOURS == get_MEAS_num_from_name("phev_ready_hours"));
+	assert(MEAS_ENERGY == get_MEAS_num_from_name("energy"));
+	assert(-1 == get_MEAS_num_from_name("phev_ready"));
+	assert(CMDS_PHEV == get_CMDS_num_from_name("phev"));
+	assert(-1 == get_CMDS_num_from_name("energy"));
+}
+
+int main(int argc, char *argv[])
+{
+	test_find();
+	test_build();
+	test_house();
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include <Schema.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+/* Writes [text] to a new temporary descriptor, whose path is
+ * left in [path]. */
+static void write_schema(char *path, const char * const text)
+{
+	int fd;
+
+	strcpy(path, "/tmp/test_SchemaXXXXXX");
+	assert(-1 != (fd = mkstemp(path)));
+	assert((ssize_t) strlen(text) == write(fd, text, strlen(text)));
+	close(fd);
+}
+
+/* Returns the schema described by [text], NULL if invalid. */
+static Schema parse(const char * const text)
+{
+	char path[32];
+	Schema ret;
+
+	write_schema(path, text);
+	ret = schema_load(path);
+	unlink(path);
+	return ret;
+}
+
+/* The built-in schema matches the House.h enums. */
+static void test_default(void)
+{
+	Schema s = schema_default();
+
+	assert(NULL != s);
+	assert(MEAS_NUMBER == schema_count(s, SCHEMA_MEAS));
+	assert(CMDS_NUMBER == schema_count(s, SCHEMA_CMDS));
+	assert(MEAS_PHEV_READY_HOURS == schema_find(s, SCHEMA_MEAS, "phev_ready_hours"));
+	assert(MEAS_BATTERY == schema_find(s, SCHEMA_MEAS, "battery"));
+	assert(CMDS_BATTERY == schema_find(s, SCHEMA_CMDS, "battery"));
+	assert(-1 == schema_find(s, SCHEMA_CMDS, "energy"));
+	assert(0 == strcmp("PHEV charge rate", schema_label(s, SCHEMA_CMDS, CMDS_PHEV)));
+	assert(NULL == schema_name(s, SCHEMA_MEAS, MEAS_NUMBER));
+	assert(sizeof(int32_t) + MEAS_NUMBER * sizeof(double) == schema_frameSize(s, SCHEMA_MEAS));
+	assert(sizeof(int32_t) + CMDS_NUMBER * sizeof(double) == schema_frameSize(s, SCHEMA_CMDS));
+
+	schema_destroy(s);
+}
+
+/* Descriptors give their entries in order, with optional labels. */
+static void test_load(void)
+{
+	Schema s = parse(
+		"# Heat pump house\n"
+		"\n"
+		"meas energy   energy load on grid\n"
+		"meas heat_pump\t# no label\n"
+		"  meas battery_2 second battery charge  \n"
+		"cmds heat_pump heat pump power\n"
+		"cmds battery_2");
+
+	assert(NULL != s);
+	assert(3 == schema_count(s, SCHEMA_MEAS));
+	assert(2 == schema_count(s, SCHEMA_CMDS));
+	assert(0 == schema_find(s, SCHEMA_MEAS, "energy"));
+	assert(1 == schema_find(s, SCHEMA_MEAS, "heat_pump"));
+	assert(2 == schema_find(s, SCHEMA_MEAS, "battery_2"));
+	assert(1 == schema_find(s, SCHEMA_CMDS, "battery_2"));
+	assert(-1 == schema_find(s, SCHEMA_MEAS, "consumption"));
+	assert(0 == strcmp("energy load on grid", schema_label(s, SCHEMA_MEAS, 0)));
+	assert(0 == strcmp("heat_pump", schema_label(s, SCHEMA_MEAS, 1)));
+	assert(0 == strcmp("second battery charge", schema_label(s, SCHEMA_MEAS, 2)));
+	assert(0 == strcmp("battery_2", schema_label(s, SCHEMA_CMDS, 1)));
+	assert(sizeof(int32_t) + 3 * sizeof(double) == schema_frameSize(s, SCHEMA_MEAS));
+	schema_destroy(s);
+
+	assert(NULL == parse("meas a\nmeas b\ncmds a\nstate c\n"));
+	assert(NULL == parse("meas a\nmeas a\ncmds a\n"));
+	assert(NULL == parse("meas a\n"));
+	assert(NULL == parse("meas\ncmds a\n"));
+	assert(NULL == schema_load("/nonexistent/schema"));
+}
+
+/* Measures may be due every few hours only. */
+static void test_every(void)
+{
+	Schema s = parse(
+		"meas energy\n"
+		"meas temperature every 4 indoor temperature\n"
+		"meas battery every 2\n"
+		"cmds battery\n");
+
+	assert(NULL != s);
+	assert(schema_isMultirate(s));
+	assert(1 == schema_every(s, 0));
+	assert(4 == schema_every(s, 1));
+	assert(2 == schema_every(s, 2));
+	assert(0 == strcmp("indoor temperature", schema_label(s, SCHEMA_MEAS, 1)));
+	assert(0 == strcmp("battery", schema_label(s, SCHEMA_MEAS, 2)));
+	assert(schema_isDue(s, 1, 1) && schema_isDue(s, 1, 5));
+	assert(!schema_isDue(s, 1, 2) && !schema_isDue(s, 1, 4));
+	assert(3 == schema_dueCount(s, 1));
+	assert(1 == schema_dueCount(s, 2));
+	assert(2 == schema_dueCount(s, 3));
+	assert(sizeof(int32_t) + 3 * sizeof(double) == schema_frameSize(s, SCHEMA_MEAS));
+	schema_destroy(s);
+
+	s = schema_default();
+	assert(!schema_isMultirate(s));
+	assert(MEAS_NUMBER == schema_dueCount(s, 2));
+	schema_destroy(s);
+
+	assert(NULL == parse("meas a every 0\ncmds a\n"));
+	assert(NULL == parse("meas a every 2x\ncmds a\n"));
+	assert(NULL == parse("meas a\ncmds a every 2\n"));
+}
+
+/* The first schema used stays in use. */
+static void test_house(void)
+{
+	char path[32];
+
+	write_schema(path, "meas energy\nmeas heat_pump\ncmds heat_pump\n");
+
+	assert(!house_hasSchema());
+	assert(0 != house_loadSchema("/nonexistent/schema"));
+	assert(!house_hasSchema());
+	assert(0 == house_loadSchema(path));
+	assert(0 == house_loadSchema(path));
+	assert(0 != house_loadSchema(NULL));
+	assert(2 == schema_count(house_getSchema(), SCHEMA_MEAS));
+	assert(1 == get_MEAS_num_from_name("heat_pump"));
+	assert(-1 == get_MEAS_num_from_name("battery"));
+	assert(0 == get_CMDS_num_from_name("heat_pump"));
+	assert(0 == strcmp("heat_pump", get_CMDS_name_from_num(0)));
+
+	unlink(path);
+}
+
+int main(int argc, char *argv[])
+{
+	test_default();
+	test_load();
+	test_every();
+	test_house();
+
+	return 0;
+}
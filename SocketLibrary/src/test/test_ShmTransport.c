@@ -0,0 +1,153 @@
+#include <ShmTransport.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SEGMENT		"/tmp/test_ShmTransport"
+#define ROUNDS		10000
+
+/* Plays the controller: asks for MEAS, answers with CMDS. */
+static int controller(void)
+{
+	ShmSegment s = SHM_attach(SEGMENT);
+	assert(NULL != s);
+
+	ShmChannel meas = SHM_getChannel(s, SOCKET_MEAS);
+	ShmChannel cmds = SHM_getChannel(s, SOCKET_CMDS);
+	double values[MEAS_NUMBER], cmd = 0.5;
+	int32_t control;
+	int i, ret;
+
+	for (i = 1; i <= ROUNDS; ++i) {
+		control = i;
+		ret = SHM_send(meas, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		ret = SHM_recv(meas, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		assert(i == control);
+		ret = SHM_recv(meas, (char *) values, sizeof(values));
+		assert(0 == ret);
+		assert(values[MEAS_NUMBER - 1] == (double) i);
+		ret = SHM_send(cmds, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		ret = SHM_send(cmds, (char *) &cmd, sizeof(cmd));
+		assert(0 == ret);
+		ret = SHM_recv(cmds, (char *) &control, sizeof(control));
+		assert(0 == ret);
+	}
+
+	SHM_detach(s);
+	return 0;
+}
+
+/* Plays a controller that crashes once attached. */
+static int crashing_controller(void)
+{
+	ShmSegment s = SHM_attach(SEGMENT);
+	assert(NULL != s);
+
+	for (;;) {
+		pause();
+	}
+	return 0;
+}
+
+int main(void)
+{
+	ShmSegment s = SHM_create(SEGMENT);
+	assert(NULL != s);
+
+	pid_t child = fork();
+	assert(0 <= child);
+	if (0 == child) {
+		exit(controller());
+	}
+
+	int ret = SHM_waitPeer(s, 5000);
+	assert(0 == ret);
+
+	ShmChannel meas = SHM_getChannel(s, SOCKET_MEAS);
+	ShmChannel cmds = SHM_getChannel(s, SOCKET_CMDS);
+	double values[MEAS_NUMBER] = {0}, cmd;
+	int32_t control;
+	struct timespec start, end;
+	pid_t waited;
+	int i, status;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 1; i <= ROUNDS; ++i) {
+		ret = SHM_wait(meas, 5000);
+		assert(ret);
+		ret = SHM_recv(meas, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		values[MEAS_NUMBER - 1] = i;
+		ret = SHM_send(meas, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		ret = SHM_send(meas, (char *) values, sizeof(values));
+		assert(0 == ret);
+		ret = SHM_wait(cmds, 5000);
+		assert(ret);
+		ret = SHM_recv(cmds, (char *) &control, sizeof(control));
+		assert(0 == ret);
+		ret = SHM_recv(cmds, (char *) &cmd, sizeof(cmd));
+		assert(0 == ret);
+		assert(0.5 == cmd);
+		ret = SHM_send(cmds, (char *) &control, sizeof(control));
+		assert(0 == ret);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	waited = waitpid(child, &status, 0);
+	assert(child == waited);
+	assert(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+
+	/* The controller is gone: a wait must not block. */
+	ret = SHM_wait(meas, 1000);
+	assert(ret);
+	ret = SHM_recv(meas, (char *) &control, sizeof(control));
+	assert(0 != ret);
+
+	fprintf(stderr, "%d MEAS/CMDS round trips, %.0f ns each.\n", ROUNDS,
+		((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / ROUNDS);
+
+	/* A new controller may attach once the segment is reset. */
+	ret = SHM_reset(s);
+	assert(0 == ret);
+	ret = SHM_waitPeer(s, 0);
+	assert(0 != ret);
+	child = fork();
+	assert(0 <= child);
+	if (0 == child) {
+		exit(crashing_controller());
+	}
+	ret = SHM_waitPeer(s, 5000);
+	assert(0 == ret);
+	ret = SHM_wait(meas, 0);
+	assert(!ret);
+
+	/* It dies without detaching: the reads notice it. */
+	kill(child, SIGKILL);
+	waited = waitpid(child, &status, 0);
+	assert(child == waited);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = SHM_wait(meas, -1);
+	assert(ret);
+	ret = SHM_recv(cmds, (char *) &control, sizeof(control));
+	assert(0 != ret);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	assert(5 > end.tv_sec - start.tv_sec);
+
+	/* Detaching the server removes the segment. */
+	SHM_detach(s);
+	s = SHM_attach(SEGMENT);
+	assert(NULL == s);
+
+	return 0;
+}
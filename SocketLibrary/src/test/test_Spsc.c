@@ -0,0 +1,80 @@
+#include <Spsc.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define ITEMS	1000000
+
+static void *producer(void *arg)
+{
+	SPSC q = arg;
+	uintptr_t i;
+
+	for (i = 1; i <= ITEMS; ++i) {
+		while (spsc_push(q, (void *) i)) {
+			/* Full, let the consumer run. */
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	SPSC q;
+	pthread_t thread;
+	uintptr_t i, expected = 1;
+	void *item;
+	int ret;
+
+	q = spsc_init(0);
+	assert(NULL == q);
+
+	/* Capacity is rounded up to a power of two. */
+	q = spsc_init(3);
+	assert(NULL != q);
+	item = spsc_pop(q);
+	assert(NULL == item);
+	for (i = 1; i <= 4; ++i) {
+		ret = spsc_push(q, (void *) i);
+		assert(0 == ret);
+	}
+	ret = spsc_push(q, (void *) i);
+	assert(0 != ret);
+	ret = spsc_push(q, NULL);
+	assert(0 != ret);
+	for (i = 1; i <= 4; ++i) {
+		item = spsc_pop(q);
+		assert((void *) i == item);
+	}
+	item = spsc_pop(q);
+	assert(NULL == item);
+	spsc_destroy(q);
+
+	/* Items cross threads in order. */
+	q = spsc_init(64);
+	ret = pthread_create(&thread, NULL, producer, q);
+	assert(0 == ret);
+	while (expected <= ITEMS) {
+		if (NULL != (item = spsc_pop(q))) {
+			assert((void *) expected == item);
+			++expected;
+		}
+		else {
+			sched_yield();
+		}
+	}
+	ret = pthread_join(thread, NULL);
+	assert(0 == ret);
+	item = spsc_pop(q);
+	assert(NULL == item);
+	spsc_destroy(q);
+
+	fprintf(stderr, "%d items passed in order.\n", ITEMS);
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include <Uring.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define ROUNDS	1000
+
+static long long now_millis(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+/* Answers every MEAS frame read on [meas] with its control on [cmds]. */
+static int controller(int meas, int cmds)
+{
+	int32_t frame[4];
+	int i;
+
+	for (i = 0; i < ROUNDS; ++i) {
+		if (sizeof(frame) != recv(meas, frame, sizeof(frame), MSG_WAITALL)) {
+			return 1;
+		}
+		if (sizeof(int32_t) != send(cmds, &frame[0], sizeof(int32_t), 0)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(void)
+{
+	Uring u = uring_create();
+
+	if (NULL == u) {
+		fprintf(stderr, "io_uring backend not available, nothing to test.\n");
+		return 0;
+	}
+
+	int meas[2], cmds[2], status, i, ret;
+	int32_t frame[4] = {0}, control;
+	struct socket_singleton s_meas = {0}, s_cmds = {0};
+	long long start;
+	pid_t child, waited;
+
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, meas);
+	assert(0 == ret);
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, cmds);
+	assert(0 == ret);
+	s_meas.accept_fd = meas[0];
+	s_meas.started = 1;
+	s_cmds.accept_fd = cmds[0];
+	s_cmds.started = 1;
+
+	/* Nothing to read: the linked timeout expires. */
+	start = now_millis();
+	ret = uring_recv(u, &s_cmds, 50);
+	assert(0 == ret);
+	assert(40 <= now_millis() - start);
+	ret = uring_recv(u, &s_cmds, 0);
+	assert(0 == ret);
+	assert(0 == socket_buffered(&s_cmds));
+
+	child = fork();
+	assert(0 <= child);
+	if (0 == child) {
+		close(meas[0]);
+		close(cmds[0]);
+		exit(controller(meas[1], cmds[1]));
+	}
+	close(meas[1]);
+	close(cmds[1]);
+
+	/* Each MEAS frame comes back with its answer prefetched. */
+	for (i = 0; i < ROUNDS; ++i) {
+		frame[0] = i;
+		socket_write(&s_meas, (char *) frame, sizeof(int32_t));
+		uring_flush(u, &s_meas, (char *) &frame[1], 3 * sizeof(int32_t), &s_cmds, 1000);
+		if (0 == socket_buffered(&s_cmds)) {
+			ret = uring_recv(u, &s_cmds, 1000);
+			assert(ret);
+		}
+		recv_complete(&s_cmds, (char *) &control, sizeof(control));
+		assert(i == control);
+	}
+
+	waited = waitpid(child, &status, 0);
+	assert(child == waited);
+	assert(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+
+	/* The controller is gone. */
+	ret = uring_recv(u, &s_cmds, 1000);
+	assert(0 == ret);
+	assert(0 == s_cmds.started);
+
+	socket_printStats(&s_meas, "MEAS");
+	socket_printStats(&s_cmds, "CMDS");
+	socket_release(&s_meas);
+	socket_release(&s_cmds);
+	ret = uring_destroy(u);
+	assert(0 == ret);
+
+	return 0;
+}
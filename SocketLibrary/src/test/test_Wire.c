@@ -0,0 +1,97 @@
+#include <Wire.h>
+#include <House.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/* Plays a framed controller on [fd]. */
+static int controller(int fd)
+{
+	struct socket_singleton s = {0};
+	struct wire_hello agreed;
+	struct wire_meas_request request = { 7, 3 };
+	struct wire_speed speed = { 7200 };
+	int32_t control;
+	int ret;
+
+	s.accept_fd = fd;
+	s.started = 1;
+
+	ret = wire_connect(&s, WIRE_CAP_FRAMED | (1 << 30), &agreed);
+	assert(0 == ret);
+	assert(WIRE_VERSION == agreed.version);
+	assert(WIRE_CAP_FRAMED == agreed.caps);
+
+	/* Out of sequence frame, refused and skipped by the server. */
+	wire_send(&s, WIRE_CMDS, &request, sizeof(request));
+	wire_send(&s, WIRE_SPEED, &speed, sizeof(speed));
+	wire_send(&s, WIRE_MEAS_REQUEST, &request, sizeof(request));
+	ret = wire_recv(&s, WIRE_CMDS_ACK, &control, sizeof(control));
+	assert(sizeof(control) == ret);
+	assert(7 == control);
+
+	return 0;
+}
+
+int main(void)
+{
+	int sv[2], status, ret;
+	pid_t child, waited;
+
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	assert(0 == ret);
+	child = fork();
+	assert(0 <= child);
+	if (0 == child) {
+		close(sv[0]);
+		exit(controller(sv[1]));
+	}
+	close(sv[1]);
+
+	struct socket_singleton s = {0};
+	struct wire_hello agreed;
+	struct wire_meas_request request;
+	union {
+		struct wire_meas_request request;
+		struct wire_speed speed;
+	} any;
+	WireTypes type;
+	int32_t control;
+
+	s.accept_fd = sv[0];
+	s.started = 1;
+
+	recv_complete(&s, (char *) &control, sizeof(control));
+	assert(CONTROL_HELLO == control);
+	ret = wire_accept(&s, &agreed);
+	assert(0 == ret);
+	assert(WIRE_CAP_FRAMED == agreed.caps);
+
+	/* A frame of the wrong type is refused. */
+	ret = wire_recv(&s, WIRE_MEAS_REQUEST, &request, sizeof(request));
+	assert(0 > ret);
+	/* Any frame type is taken, given it fits. */
+	ret = wire_recvAny(&s, &type, &any, sizeof(any));
+	assert(sizeof(any.speed) == ret);
+	assert((WIRE_SPEED == type) && (7200 == any.speed.speed));
+	ret = wire_recv(&s, WIRE_MEAS_REQUEST, &request, sizeof(request));
+	assert(sizeof(request) == ret);
+	assert((7 == request.control) && (3 == request.max_hours));
+
+	wire_send(&s, WIRE_CMDS_ACK, &request.control, sizeof(int32_t));
+
+	waited = waitpid(child, &status, 0);
+	assert(child == waited);
+	assert(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+
+	fprintf(stderr, "Handshake agreed version %d caps 0x%x.\n", agreed.version, agreed.caps);
+	socket_printStats(&s, "server");
+	socket_release(&s);
+
+	return 0;
+}
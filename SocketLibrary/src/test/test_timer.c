@@ -3,6 +3,261 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <assert.h>
+#include <sys/socket.h>
+
+#define FAST_SPEED	36000	/* one hour every 100 ms */
+#define FAST_QUERIES	10
+#define FAST_MILLIS	100
+
+static void test_schedule(void)
+{
+	Timer t = create_timer(FAST_SPEED, FAST_QUERIES);
+	unsigned long long before;
+	int timeout, ret;
+
+	assert(NULL == create_timer(FAST_SPEED, 0));
+	assert(NULL != t);
+	assert(!timer_isLockstep(t));
+	assert(FAST_MILLIS * 1000ULL == timer_interval_micros(t));
+
+	/* Hours never start in the future. */
+	ret = reset_timer(t);
+	assert(0 == ret);
+	ret = reset_timer(t);
+	assert(0 == ret);
+	timeout = timer_timeout_millis(t, FAST_QUERIES - 1);
+	assert((0 < timeout) && (FAST_MILLIS >= timeout));
+	assert(FAST_MILLIS / FAST_QUERIES >= timer_timeout_millis(t, 0));
+
+	/* A late hour is caught up on the next one. */
+	before = timer_now_nanos();
+	usleep(FAST_MILLIS * 1500);
+	ret = reset_timer(t);
+	assert(0 == ret);
+	timeout = timer_timeout_millis(t, FAST_QUERIES - 1);
+	if (timer_now_nanos() - before < 2 * FAST_MILLIS * 1000000ULL) {
+		assert(FAST_MILLIS > timeout);
+	}
+	printf("late hour left %d milliseconds\n", timeout);
+
+	/* More than an interval behind, the schedule is re-anchored. */
+	usleep(FAST_MILLIS * 2500);
+	ret = reset_timer(t);
+	assert(0 == ret);
+	assert(FAST_MILLIS - FAST_MILLIS / FAST_QUERIES < timer_timeout_millis(t, FAST_QUERIES - 1));
+
+	destroy_timer(t);
+}
+
+static void test_timerfd(void)
+{
+	Timer t = create_timer(FAST_SPEED, FAST_QUERIES);
+	unsigned long long before;
+	int fds[2], ret;
+
+	assert(NULL != t);
+	ret = pipe(fds);
+	assert(0 == ret);
+	if (timer_enableFd(t)) {
+		printf("timerfd unavailable\n");
+	}
+	ret = reset_timer(t);
+	assert(0 == ret);
+
+	/* Nothing to read: the wait lasts until the end of the step. */
+	before = timer_now_nanos();
+	ret = read_possible(t, 0, fds[0]);
+	assert(0 == ret);
+	assert(timer_now_nanos() - before >= (FAST_MILLIS * 1000000ULL) / FAST_QUERIES / 2);
+	assert(0 == timer_timeout_millis(t, 0));
+
+	ret = write(fds[1], "x", 1);
+	assert(1 == ret);
+	ret = read_possible(t, FAST_QUERIES - 1, fds[0]);
+	assert(0 != ret);
+
+	close(fds[0]);
+	close(fds[1]);
+	destroy_timer(t);
+}
+
+static void test_lockstep(void)
+{
+	Timer t = create_timer(0, FAST_QUERIES);
+	int fds[2], ret;
+
+	assert(NULL != t);
+	assert(timer_isLockstep(t));
+	assert(0 == timer_interval_micros(t));
+	ret = reset_timer(t);
+	assert(0 == ret);
+	assert(-1 == timer_timeout_millis(t, FAST_QUERIES - 1));
+
+	/* No deadline: only data ends the wait. */
+	ret = pipe(fds);
+	assert(0 == ret);
+	ret = write(fds[1], "x", 1);
+	assert(1 == ret);
+	ret = read_possible(t, 0, fds[0]);
+	assert(0 != ret);
+
+	close(fds[0]);
+	close(fds[1]);
+	destroy_timer(t);
+}
+
+static void test_adaptive(void)
+{
+	Timer t = create_timer(FAST_SPEED, FAST_QUERIES);
+	unsigned int speed;
+	int i;
+
+	assert(NULL != t);
+	assert(0 != timer_setAdaptive(t, 100));
+
+	/* Fixed speed: round trips are ignored. */
+	timer_adapt(t, FAST_MILLIS * 1000ULL);
+	assert(FAST_SPEED == timer_getSpeed(t));
+
+	/* A round trip longer than the first step slows down at once:
+	 * 20 ms with 50% slack needs 40 ms steps. */
+	assert(0 == timer_setAdaptive(t, 50));
+	timer_adapt(t, 20000ULL);
+	assert(FAST_SPEED / 4 == timer_getSpeed(t));
+
+	/* Fast round trips speed up, a little at a time. */
+	for (i = 0; i < 100; ++i) {
+		speed = timer_getSpeed(t);
+		timer_adapt(t, 100ULL);
+		assert(timer_getSpeed(t) >= speed);
+	}
+	assert(FAST_SPEED < timer_getSpeed(t));
+
+	/* A speed set by hand is kept. */
+	assert(0 == timer_setAdaptive(t, 0));
+	assert(0 == timer_setSpeed(t, FAST_SPEED));
+	timer_adapt(t, FAST_MILLIS * 1000ULL);
+	assert(FAST_SPEED == timer_getSpeed(t));
+	assert(FAST_MILLIS * 1000ULL == timer_interval_micros(t));
+
+	destroy_timer(t);
+}
+
+/* Shorter intervals play faster at the same speed. */
+static void test_period(void)
+{
+	Timer t = create_timer(FAST_SPEED, FAST_QUERIES);
+
+	assert(NULL != t);
+	assert(0 != timer_setPeriod(t, 0));
+	assert(0 == timer_setPeriod(t, 900));
+	assert(FAST_SPEED == timer_getSpeed(t));
+	assert(FAST_MILLIS * 1000ULL / 4 == timer_interval_micros(t));
+
+	/* The adaptive speed slows down to a whole interval per
+	 * interval at most. */
+	assert(0 == timer_setAdaptive(t, 50));
+	timer_adapt(t, 3600ULL * 1000000ULL);
+	assert(1 == timer_getSpeed(t));
+	assert(900ULL * 1000000ULL == timer_interval_micros(t));
+
+	destroy_timer(t);
+}
+
+static void test_waits(void)
+{
+	TimerWaits wait;
+	Timer t;
+	int fds[2], ret;
+	char c;
+
+	for (wait = TIMER_WAIT_SPIN; wait < TIMER_WAIT_NUMBER; ++wait) {
+		t = create_timer(FAST_SPEED, FAST_QUERIES);
+		assert(NULL != t);
+		ret = timer_setWait(t, wait, 0);
+		assert(0 != ret);
+		ret = timer_setWait(t, TIMER_WAIT_NUMBER, 10);
+		assert(0 != ret);
+		ret = timer_setWait(t, wait, 1000);
+		assert(0 == ret);
+		ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		assert(0 == ret);
+		ret = reset_timer(t);
+		assert(0 == ret);
+
+		/* Data already there is caught while spinning. */
+		ret = write(fds[1], "x", 1);
+		assert(1 == ret);
+		ret = read_possible(t, 0, fds[0]);
+		assert(0 != ret);
+		ret = read(fds[0], &c, 1);
+		assert(1 == ret);
+
+		/* Without data, the wait still ends with the step. */
+		ret = read_possible(t, 1, fds[0]);
+		assert(0 == ret);
+		assert(0 == timer_timeout_millis(t, 1));
+
+		/* A closed peer ends the wait, like poll reports it. */
+		close(fds[1]);
+		read_possible(t, 2, fds[0]);
+		assert(0 < timer_timeout_millis(t, 2));
+
+		timer_printStats(t, (TIMER_WAIT_SPIN == wait) ? "spin" : "busy");
+		close(fds[0]);
+		destroy_timer(t);
+	}
+}
+
+/* The busy wait keeps SO_BUSY_POLL on both sockets it alternates on. */
+static void test_busy_fds(void)
+{
+	Timer t = create_timer(0, FAST_QUERIES);
+	int meas[2], cmds[2], usecs[2], ret, i;
+	socklen_t len;
+	char c;
+
+	assert(NULL != t);
+	ret = timer_setWait(t, TIMER_WAIT_BUSY, 1000);
+	assert(0 == ret);
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, meas);
+	assert(0 == ret);
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, cmds);
+	assert(0 == ret);
+
+	for (i = 0; i < 4; ++i) {
+		ret = write(meas[1], "m", 1);
+		assert(1 == ret);
+		ret = read_possible(t, 0, meas[0]);
+		assert(0 != ret);
+		ret = read(meas[0], &c, 1);
+		assert(1 == ret);
+		ret = write(cmds[1], "c", 1);
+		assert(1 == ret);
+		ret = read_possible(t, 0, cmds[0]);
+		assert(0 != ret);
+		ret = read(cmds[0], &c, 1);
+		assert(1 == ret);
+	}
+
+#ifdef SO_BUSY_POLL
+	/* Set on both, or refused on both without CAP_NET_ADMIN. */
+	len = sizeof(usecs[0]);
+	ret = getsockopt(meas[0], SOL_SOCKET, SO_BUSY_POLL, &usecs[0], &len);
+	assert(0 == ret);
+	ret = getsockopt(cmds[0], SOL_SOCKET, SO_BUSY_POLL, &usecs[1], &len);
+	assert(0 == ret);
+	assert(usecs[0] == usecs[1]);
+#endif
+
+	timer_forgetFds(t);
+	close(meas[0]);
+	close(meas[1]);
+	close(cmds[0]);
+	close(cmds[1]);
+	destroy_timer(t);
+}
 
 int main(void)
 {
@@ -24,8 +279,15 @@ int main(void)
 		}
 		++s;
 	}
+	destroy_timer(t);
+
+	test_schedule();
+	test_timerfd();
+	test_lockstep();
+	test_adaptive();
+	test_period();
+	test_waits();
+	test_busy_fds();
 
 	return 0;
 }
-
-